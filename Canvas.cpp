@@ -0,0 +1,456 @@
+#include "Canvas.hpp"
+#include <algorithm>
+
+namespace
+{
+    /** A value no packed cell can take, used for cells whose committed state is unknown. */
+    const std::uint64_t unknownCell = ~std::uint64_t (0);
+
+    /** Set in the glyphs of characters which did not come from a chtype. */
+    const std::uint32_t wideGlyphFlag = 0x80000000u;
+    /** Set as well as wideGlyphFlag in the glyphs of cells with combining marks. */
+    const std::uint32_t markedGlyphFlag = 0x40000000u;
+    /** The glyph of a cell covered by the right half of a two column character. */
+    const std::uint32_t continuationGlyph = 0xffffffffu;
+
+    bool hasMarks (std::uint32_t glyph)
+    {
+        return glyph != continuationGlyph && (glyph & markedGlyphFlag) != 0;
+    }
+
+    /** Runs of changed cells separated by no more than this many unchanged cells are
+     *  written with one call, as rewriting a few cells is cheaper than another call.
+     */
+    const int maximumUnchangedGap = 4;
+}
+
+Canvas::Canvas (int widthInit, int heightInit)
+    : width (0), height (0),
+      cursorX (0), cursorY (0)
+{
+    resize (widthInit, heightInit);
+}
+
+Canvas::~Canvas()
+{
+}
+
+void Canvas::resize (int newWidth, int newHeight)
+{
+    width = std::max (newWidth, 0);
+    height = std::max (newHeight, 0);
+
+    int numCells = width * height;
+    glyphs.assign (numCells, ' ');
+    attributes.assign (numCells, A_NORMAL);
+    colourPairs.assign (numCells, 0);
+    combiningMarks.clear();
+    committedMarks.clear();
+
+    dirtyStarts.assign (height, width);
+    dirtyEnds.assign (height, 0);
+    rowBuffer.resize (width);
+    wideRowBuffer.resize (width);
+
+    cursorX = 0;
+    cursorY = 0;
+
+    invalidate();
+}
+
+int Canvas::getWidth() const
+{
+    return width;
+}
+
+int Canvas::getHeight() const
+{
+    return height;
+}
+
+void Canvas::setCell (const chtype character, int x, int y)
+{
+    if (x < 0 || x >= width || y < 0 || y >= height)
+    {
+        return;
+    }
+
+    splitWideCharacters (y, x, x + 1);
+
+    int index = y * width + x;
+    storeCell (index, character);
+    markDirty (y, x, x + 1);
+}
+
+void Canvas::setCells (const chtype *characters, int length, int x, int y)
+{
+    if (y < 0 || y >= height)
+    {
+        return;
+    }
+
+    int startX = std::max (x, 0);
+    int endX = std::min (x + length, width);
+
+    if (startX >= endX)
+    {
+        return;
+    }
+
+    splitWideCharacters (y, startX, endX);
+
+    const chtype *source = characters + (startX - x);
+    int index = y * width + startX;
+
+    for (int column = startX; column < endX; ++column)
+    {
+        storeCell (index++, *source++);
+    }
+
+    markDirty (y, startX, endX);
+}
+
+void Canvas::fillCells (const chtype character, int length, int x, int y)
+{
+    if (y < 0 || y >= height)
+    {
+        return;
+    }
+
+    int startX = std::max (x, 0);
+    int endX = std::min (x + length, width);
+
+    if (startX >= endX)
+    {
+        return;
+    }
+
+    splitWideCharacters (y, startX, endX);
+
+    int index = y * width + startX;
+
+    for (int column = startX; column < endX; ++column)
+    {
+        storeCell (index++, character);
+    }
+
+    markDirty (y, startX, endX);
+}
+
+void Canvas::setWideCell (wchar_t character, const wchar_t *marks, int numMarks, int characterWidth,
+                          attr_t characterAttributes, short colourPair, int x, int y)
+{
+    if (x < 0 || x >= width || y < 0 || y >= height)
+    {
+        return;
+    }
+
+    if (characterWidth > 1 && x + 1 >= width)
+    {
+        character = L' ';
+        characterWidth = 1;
+        numMarks = 0;
+    }
+
+    int endX = x + std::max (std::min (characterWidth, 2), 1);
+    splitWideCharacters (y, x, endX);
+
+    int index = y * width + x;
+    numMarks = std::min (std::max (numMarks, 0), DisplayText::maxCombiningMarks);
+
+    if (numMarks > 0)
+    {
+        if (combiningMarks.empty())
+        {
+            combiningMarks.assign (glyphs.size() * DisplayText::maxCombiningMarks, L'\0');
+            committedMarks.assign (glyphs.size() * DisplayText::maxCombiningMarks, L'\0');
+        }
+
+        wchar_t *cellMarks = combiningMarks.data() + index * DisplayText::maxCombiningMarks;
+        std::copy (marks, marks + numMarks, cellMarks);
+        std::fill (cellMarks + numMarks, cellMarks + DisplayText::maxCombiningMarks, L'\0');
+
+        glyphs [index] = static_cast <std::uint32_t> (character) | wideGlyphFlag | markedGlyphFlag;
+    }
+    else
+    {
+        glyphs [index] = character < 0x80 ? static_cast <std::uint32_t> (character)
+                                          : static_cast <std::uint32_t> (character) | wideGlyphFlag;
+    }
+
+    for (int column = x; column < endX; ++column)
+    {
+        if (column > x)
+        {
+            glyphs [index] = continuationGlyph;
+        }
+
+        attributes [index] = characterAttributes & ~A_COLOR;
+        colourPairs [index] = colourPair;
+        ++index;
+    }
+
+    markDirty (y, x, endX);
+}
+
+chtype Canvas::getCell (int x, int y) const
+{
+    if (x < 0 || x >= width || y < 0 || y >= height)
+    {
+        return 0;
+    }
+
+    int index = y * width + x;
+    chtype glyph = (glyphs [index] & wideGlyphFlag) != 0 ? ' ' : glyphs [index];
+
+    return glyph | attributes [index] | COLOR_PAIR (colourPairs [index]);
+}
+
+bool Canvas::hasCell (const chtype character, int x, int y) const
+{
+    if (x < 0 || x >= width || y < 0 || y >= height)
+    {
+        return false;
+    }
+
+    int index = y * width + x;
+
+    return glyphs [index] == (character & A_CHARTEXT)
+           && attributes [index] == (character & (A_ATTRIBUTES & ~A_COLOR))
+           && colourPairs [index] == PAIR_NUMBER (character);
+}
+
+void Canvas::clear()
+{
+    std::fill (glyphs.begin(), glyphs.end(), ' ');
+    std::fill (attributes.begin(), attributes.end(), A_NORMAL);
+    std::fill (colourPairs.begin(), colourPairs.end(), 0);
+
+    for (int y = 0; y < height; ++y)
+    {
+        markDirty (y, 0, width);
+    }
+
+    cursorX = 0;
+    cursorY = 0;
+}
+
+void Canvas::moveCursor (int x, int y)
+{
+    bool inside = x >= 0 && x < width && y >= 0 && y < height;
+
+    cursorX = inside ? x : -1;
+    cursorY = inside ? y : -1;
+}
+
+int Canvas::getCursorX() const
+{
+    return cursorX;
+}
+
+int Canvas::getCursorY() const
+{
+    return cursorY;
+}
+
+void Canvas::printCharacter (const chtype character)
+{
+    if (cursorY < 0)
+    {
+        return;
+    }
+
+    setCell (character, cursorX, cursorY);
+
+    if (++cursorX >= width && cursorY < height - 1)
+    {
+        cursorX = 0;
+        ++cursorY;
+    }
+}
+
+void Canvas::invalidate()
+{
+    committedCells.assign (width * height, unknownCell);
+
+    for (int y = 0; y < height; ++y)
+    {
+        markDirty (y, 0, width);
+    }
+}
+
+bool Canvas::isDirty() const
+{
+    for (int y = 0; y < height; ++y)
+    {
+        if (dirtyStarts [y] < dirtyEnds [y])
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Canvas::commit (TerminalWindow &window)
+{
+    for (int y = 0; y < height; ++y)
+    {
+        int spanStart = dirtyStarts [y];
+        int spanEnd = dirtyEnds [y];
+
+        dirtyStarts [y] = width;
+        dirtyEnds [y] = 0;
+
+        int rowIndex = y * width;
+        int runStart = -1;
+        int runEnd = -1;
+
+        for (int x = spanStart; x < spanEnd; ++x)
+        {
+            if (! isChanged (rowIndex + x))
+            {
+                continue;
+            }
+
+            if (runStart >= 0 && x - runEnd > maximumUnchangedGap)
+            {
+                writeRun (window, y, runStart, runEnd);
+                runStart = -1;
+            }
+
+            if (runStart < 0)
+            {
+                runStart = x;
+            }
+
+            runEnd = x + 1;
+        }
+
+        if (runStart >= 0)
+        {
+            writeRun (window, y, runStart, runEnd);
+        }
+    }
+}
+
+void Canvas::writeRun (TerminalWindow &window, int y, int startX, int endX)
+{
+    int rowIndex = y * width;
+
+    // Two column characters are written whole.
+    while (startX > 0 && glyphs [rowIndex + startX] == continuationGlyph)
+    {
+        --startX;
+    }
+
+    while (endX < width && glyphs [rowIndex + endX] == continuationGlyph)
+    {
+        ++endX;
+    }
+
+    bool isWide = false;
+
+    for (int x = startX; x < endX; ++x)
+    {
+        int index = rowIndex + x;
+        committedCells [index] = packCell (index);
+        isWide = isWide || (glyphs [index] & wideGlyphFlag) != 0;
+
+        if (hasMarks (glyphs [index]))
+        {
+            std::copy_n (combiningMarks.begin() + index * DisplayText::maxCombiningMarks,
+                         DisplayText::maxCombiningMarks,
+                         committedMarks.begin() + index * DisplayText::maxCombiningMarks);
+        }
+    }
+
+    if (! isWide)
+    {
+        for (int x = startX; x < endX; ++x)
+        {
+            rowBuffer [x] = glyphs [rowIndex + x] | attributes [rowIndex + x]
+                            | COLOR_PAIR (colourPairs [rowIndex + x]);
+        }
+
+        window.setCells (rowBuffer.data() + startX, endX - startX, startX, y);
+        return;
+    }
+
+    // ncurses fills in the cells covered by two column characters itself.
+    int count = 0;
+
+    for (int x = startX; x < endX; ++x)
+    {
+        int index = rowIndex + x;
+        std::uint32_t glyph = glyphs [index];
+
+        if (glyph == continuationGlyph)
+        {
+            continue;
+        }
+
+        // The character is followed by its combining marks, if any, and then a null.
+        wchar_t text [DisplayText::maxCombiningMarks + 2] = {};
+        text [0] = static_cast <wchar_t> (glyph & ~(wideGlyphFlag | markedGlyphFlag));
+
+        if (hasMarks (glyph))
+        {
+            std::copy_n (combiningMarks.begin() + index * DisplayText::maxCombiningMarks,
+                         DisplayText::maxCombiningMarks, text + 1);
+        }
+
+        setcchar (&wideRowBuffer [count++], text, attributes [index], colourPairs [index], nullptr);
+    }
+
+    window.setWideCells (wideRowBuffer.data(), count, startX, y);
+}
+
+void Canvas::storeCell (int index, const chtype character)
+{
+    glyphs [index] = character & A_CHARTEXT;
+    attributes [index] = character & (A_ATTRIBUTES & ~A_COLOR);
+    colourPairs [index] = static_cast <short> (PAIR_NUMBER (character));
+}
+
+std::uint64_t Canvas::packCell (int index) const
+{
+    return (static_cast <std::uint64_t> (glyphs [index]) << 32)
+           | attributes [index] | COLOR_PAIR (colourPairs [index]);
+}
+
+bool Canvas::isChanged (int index) const
+{
+    if (packCell (index) != committedCells [index])
+    {
+        return true;
+    }
+
+    return hasMarks (glyphs [index])
+           && ! std::equal (combiningMarks.begin() + index * DisplayText::maxCombiningMarks,
+                            combiningMarks.begin() + (index + 1) * DisplayText::maxCombiningMarks,
+                            committedMarks.begin() + index * DisplayText::maxCombiningMarks);
+}
+
+void Canvas::markDirty (int y, int startX, int endX)
+{
+    dirtyStarts [y] = std::min (dirtyStarts [y], startX);
+    dirtyEnds [y] = std::max (dirtyEnds [y], endX);
+}
+
+void Canvas::splitWideCharacters (int y, int startX, int endX)
+{
+    int rowIndex = y * width;
+
+    if (startX > 0 && glyphs [rowIndex + startX] == continuationGlyph)
+    {
+        glyphs [rowIndex + startX - 1] = ' ';
+        markDirty (y, startX - 1, startX);
+    }
+
+    if (endX < width && glyphs [rowIndex + endX] == continuationGlyph)
+    {
+        glyphs [rowIndex + endX] = ' ';
+        markDirty (y, endX, endX + 1);
+    }
+}
@@ -0,0 +1,177 @@
+#ifndef CANVAS_HPP_INCLUDED
+#define CANVAS_HPP_INCLUDED
+
+#include <cstdint>
+#include <vector>
+#include "DisplayTextCache.hpp"
+#include "TerminalBackend.hpp"
+
+/** An off-screen grid of cells which can be committed to a terminal window.
+ *
+ *  Cells are stored as separate arrays of glyphs, attributes and colour pairs. Each row
+ *  keeps track of the span of cells which have changed since the last commit, and a commit
+ *  only pushes the cells in those spans which differ from what was previously committed.
+ *
+ *  Cells can also hold characters from outside ASCII, which are committed as cchar_ts.
+ *  Runs of cells with only ASCII and line drawing characters are still committed as
+ *  chtypes.
+ */
+class Canvas
+{
+public:
+    /** Constructor
+     *
+     *  @param widthInit the width of the canvas
+     *  @param heightInit the height of the canvas
+     */
+    Canvas (int widthInit, int heightInit);
+    /** Destructor */
+    ~Canvas();
+
+    /** Resize the canvas.
+     *
+     *  The contents of the canvas are cleared and the next commit will rewrite every cell.
+     *
+     *  @param newWidth the new width
+     *  @param newHeight the new height
+     */
+    void resize (int newWidth, int newHeight);
+
+    /** Returns the canvas width. */
+    int getWidth() const;
+    /** Returns the canvas height. */
+    int getHeight() const;
+
+    /** Set a single cell. Positions outside the canvas are ignored.
+     *
+     *  @param character the character to set, with its attributes and colour pair
+     *  @param x the x position of the cell
+     *  @param y the y position of the cell
+     */
+    void setCell (const chtype character, int x, int y);
+    /** Set a run of cells on one row from an array. The run is clipped to the canvas.
+     *
+     *  @param characters the characters to set, with their attributes and colour pairs
+     *  @param length the number of characters
+     *  @param x the x position of the first cell
+     *  @param y the y position of the row
+     */
+    void setCells (const chtype *characters, int length, int x, int y);
+    /** Set a run of cells on one row to the same character. The run is clipped to the canvas.
+     *
+     *  @param character the character to set, with its attributes and colour pair
+     *  @param length the number of cells
+     *  @param x the x position of the first cell
+     *  @param y the y position of the row
+     */
+    void fillCells (const chtype character, int length, int x, int y);
+    /** Set a cell to a character from outside ASCII. A character two columns wide also
+     *  covers the cell to its right, and is replaced by a blank if that is outside the
+     *  canvas. Positions outside the canvas are ignored.
+     *
+     *  @param character the character to set
+     *  @param marks the combining marks shown in the same cell as the character
+     *  @param numMarks the number of combining marks, no more than
+     *                  DisplayText::maxCombiningMarks
+     *  @param characterWidth the number of columns the character takes, 1 or 2
+     *  @param characterAttributes the attributes of the character, without a colour pair
+     *  @param colourPair the colour pair of the character
+     *  @param x the x position of the cell
+     *  @param y the y position of the cell
+     */
+    void setWideCell (wchar_t character, const wchar_t *marks, int numMarks, int characterWidth,
+                      attr_t characterAttributes, short colourPair, int x, int y);
+    /** Returns the contents of a cell.
+     *
+     *  A cell holding a character from outside ASCII is returned as a blank with the
+     *  cell's attributes and colour pair.
+     *
+     *  @param x the x position of the cell
+     *  @param y the y position of the cell
+     */
+    chtype getCell (int x, int y) const;
+    /** Returns true if a cell holds exactly this character, with these attributes and
+     *  this colour pair. Always false outside the canvas.
+     *
+     *  @param character the character, attributes and colour pair to look for
+     *  @param x the x position of the cell
+     *  @param y the y position of the cell
+     */
+    bool hasCell (const chtype character, int x, int y) const;
+
+    /** Set every cell to a blank. */
+    void clear();
+
+    /** Move the cursor.
+     *
+     *  As with wmove, a position outside the canvas is rejected. The cursor is then left
+     *  invalid, and nothing is printed until it is moved back inside the canvas.
+     *
+     *  @param x the new x position
+     *  @param y the new y position
+     */
+    void moveCursor (int x, int y);
+    /** Returns the x position of the cursor, or -1 if the cursor is invalid. */
+    int getCursorX() const;
+    /** Returns the y position of the cursor, or -1 if the cursor is invalid. */
+    int getCursorY() const;
+    /** Set the cell at the cursor and advance the cursor, wrapping at the end of a row.
+     *  Does nothing while the cursor is invalid.
+     *
+     *  @param character the character to set, with its attributes and colour pair
+     */
+    void printCharacter (const chtype character);
+
+    /** Forget what has been committed so that the next commit rewrites every cell. */
+    void invalidate();
+    /** Returns true if any cells have changed since the last commit. */
+    bool isDirty() const;
+
+    /** Write the cells which have changed since the last commit to a window.
+     *
+     *  Each run of changed cells is written with a single call. The caller must hold a
+     *  Curses::Lock.
+     *
+     *  @param window the window to write to
+     */
+    void commit (TerminalWindow &window);
+
+private:
+    Canvas (const Canvas&) = delete;
+    Canvas& operator= (const Canvas&) = delete;
+
+    int width, height;
+    int cursorX, cursorY;
+
+    /** The character of each cell. Characters from chtypes are stored as they are, and
+     *  other characters are marked with a flag, and with another if the cell has
+     *  combining marks.
+     */
+    std::vector <std::uint32_t> glyphs;
+    std::vector <attr_t> attributes;
+    std::vector <short> colourPairs;
+    /** DisplayText::maxCombiningMarks marks for each cell, padded with nulls, which only
+     *  mean anything for cells flagged as having them. Both are left empty until a mark
+     *  is first set.
+     */
+    std::vector <wchar_t> combiningMarks, committedMarks;
+
+    std::vector <std::uint64_t> committedCells;
+    std::vector <int> dirtyStarts, dirtyEnds;
+
+    std::vector <chtype> rowBuffer;
+    std::vector <cchar_t> wideRowBuffer;
+
+    void storeCell (int index, const chtype character);
+    std::uint64_t packCell (int index) const;
+    /** Returns true if a cell differs from what was last committed. */
+    bool isChanged (int index) const;
+    void markDirty (int y, int startX, int endX);
+    /** Blank the other half of any two column characters which a write to a run of cells
+     *  would cut in two.
+     */
+    void splitWideCharacters (int y, int startX, int endX);
+    void writeRun (TerminalWindow &window, int y, int startX, int endX);
+};
+
+#endif // CANVAS_HPP_INCLUDED
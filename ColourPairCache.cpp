@@ -0,0 +1,143 @@
+#include "ColourPairCache.hpp"
+#include <algorithm>
+
+namespace
+{
+    const int noSlot = -1;
+
+    int makeKey (short foregroundColour, short backgroundColour)
+    {
+        // Colours are at most 16 bits, and -1 is the terminal's default colour.
+        return static_cast <int> ((static_cast <unsigned> (static_cast <unsigned short> (foregroundColour)) << 16)
+                                  | static_cast <unsigned short> (backgroundColour));
+    }
+}
+
+const int ColourPairCache::maxCapacity;
+
+ColourPairCache::ColourPairCache (TerminalBackend &backendInit, int capacityInit)
+    : backend (backendInit),
+      capacity (std::max (std::min (capacityInit, maxCapacity), 0)),
+      mostRecent (noSlot), leastRecent (noSlot),
+      hits (0), misses (0), evictions (0),
+      generation (0)
+{
+    slots.reserve (capacity);
+    slotIndexes.reserve (capacity);
+}
+
+ColourPairCache::~ColourPairCache()
+{
+}
+
+short ColourPairCache::getPair (short foregroundColour, short backgroundColour)
+{
+    if (capacity == 0)
+    {
+        return 0;
+    }
+
+    int key = makeKey (foregroundColour, backgroundColour);
+    auto found = slotIndexes.find (key);
+
+    if (found != slotIndexes.end())
+    {
+        ++hits;
+        int slotIndex = found->second;
+
+        if (slotIndex != mostRecent)
+        {
+            unlink (slotIndex);
+            pushFront (slotIndex);
+        }
+
+        return static_cast <short> (slotIndex + 1);
+    }
+
+    ++misses;
+    int slotIndex;
+
+    if (static_cast <int> (slots.size()) < capacity)
+    {
+        slotIndex = static_cast <int> (slots.size());
+        slots.push_back (Slot {key, noSlot, noSlot});
+    }
+    else
+    {
+        ++evictions;
+        ++generation;
+        slotIndex = leastRecent;
+        unlink (slotIndex);
+        slotIndexes.erase (slots [slotIndex].key);
+        slots [slotIndex].key = key;
+    }
+
+    slotIndexes.emplace (key, slotIndex);
+    pushFront (slotIndex);
+
+    short pair = static_cast <short> (slotIndex + 1);
+    backend.initialiseColourPair (pair, foregroundColour, backgroundColour);
+
+    return pair;
+}
+
+ColourPairCache::Statistics ColourPairCache::getStatistics() const
+{
+    return Statistics {hits, misses, evictions, static_cast <int> (slots.size()), capacity};
+}
+
+void ColourPairCache::resetStatistics()
+{
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+}
+
+unsigned long ColourPairCache::getGeneration() const
+{
+    return generation;
+}
+
+void ColourPairCache::unlink (int slotIndex)
+{
+    Slot &slot = slots [slotIndex];
+
+    if (slot.previous != noSlot)
+    {
+        slots [slot.previous].next = slot.next;
+    }
+    else
+    {
+        mostRecent = slot.next;
+    }
+
+    if (slot.next != noSlot)
+    {
+        slots [slot.next].previous = slot.previous;
+    }
+    else
+    {
+        leastRecent = slot.previous;
+    }
+
+    slot.previous = noSlot;
+    slot.next = noSlot;
+}
+
+void ColourPairCache::pushFront (int slotIndex)
+{
+    Slot &slot = slots [slotIndex];
+    slot.previous = noSlot;
+    slot.next = mostRecent;
+
+    if (mostRecent != noSlot)
+    {
+        slots [mostRecent].previous = slotIndex;
+    }
+    else
+    {
+        leastRecent = slotIndex;
+    }
+
+    mostRecent = slotIndex;
+}
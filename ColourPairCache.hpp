@@ -0,0 +1,94 @@
+#ifndef COLOUR_PAIR_CACHE_HPP_INCLUDED
+#define COLOUR_PAIR_CACHE_HPP_INCLUDED
+
+#include <unordered_map>
+#include <vector>
+#include "TerminalBackend.hpp"
+
+/** Allocates ncurses colour pairs on demand and recycles the least recently used ones.
+ *
+ *  A pair is only initialised, through the terminal backend, the first time its combination
+ *  of colours is asked for. Looking a combination up is a hash lookup plus relinking one
+ *  entry of an intrusive list, so it takes constant time. Once every pair is in use, the pair used
+ *  least recently is given the new colours.
+ *
+ *  Changing a pair recolours every cell on the screen already drawn with it, so the cache
+ *  should be large enough for all the combinations visible at once. Pairs are packed into
+ *  chtypes with COLOR_PAIR, which holds at most 255 pairs, so no more than that are used
+ *  even on terminals offering more.
+ *
+ *  Callers must hold a Curses::Lock.
+ */
+class ColourPairCache
+{
+public:
+    /** The most pairs which fit in a chtype, not counting the default pair 0. */
+    static const int maxCapacity = 255;
+
+    /** Constructor
+     *
+     *  @param backendInit the backend to initialise pairs with
+     *  @param capacityInit the number of pairs to allocate from, starting at pair 1. This is
+     *                      limited to maxCapacity.
+     */
+    ColourPairCache (TerminalBackend &backendInit, int capacityInit);
+    /** Destructor */
+    ~ColourPairCache();
+
+    /** Returns the pair for a combination of colours, initialising a pair if needed.
+     *
+     *  Returns the default pair 0 if the cache has no pairs to allocate from.
+     *
+     *  @param foregroundColour the foreground colour number
+     *  @param backgroundColour the background colour number
+     */
+    short getPair (short foregroundColour, short backgroundColour);
+
+    /** Counts of how the cache has been used. */
+    struct Statistics
+    {
+        long hits; /**< The number of lookups which found a pair already set up. */
+        long misses; /**< The number of lookups which had to initialise a pair. */
+        long evictions; /**< The number of misses which recycled a pair in use. */
+        int pairsInUse; /**< The number of pairs which have been initialised. */
+        int capacity; /**< The number of pairs the cache allocates from. */
+    };
+
+    /** Returns counts of how the cache has been used. */
+    Statistics getStatistics() const;
+    /** Set the hit, miss and eviction counts back to zero. */
+    void resetStatistics();
+
+    /** Returns a number which changes whenever a pair in use is given new colours.
+     *
+     *  Anything keeping a pair number can compare this with the value it saw when it got
+     *  the pair, and look its colours up again if it has changed. It is not affected by
+     *  resetStatistics.
+     */
+    unsigned long getGeneration() const;
+
+private:
+    ColourPairCache (const ColourPairCache&) = delete;
+    ColourPairCache& operator= (const ColourPairCache&) = delete;
+
+    /** An entry in the list of pairs, most recently used first. Slot i holds pair i + 1. */
+    struct Slot
+    {
+        int key;
+        int previous, next;
+    };
+
+    TerminalBackend &backend;
+    int capacity;
+    std::vector <Slot> slots;
+    std::unordered_map <int, int> slotIndexes;
+    int mostRecent, leastRecent;
+
+    long hits, misses, evictions;
+    unsigned long generation;
+
+    void unlink (int slotIndex);
+    void pushFront (int slotIndex);
+};
+
+#endif // COLOUR_PAIR_CACHE_HPP_INCLUDED
@@ -0,0 +1,158 @@
+#ifndef COMMAND_QUEUE_HPP_INCLUDED
+#define COMMAND_QUEUE_HPP_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+/** A bounded lock-free queue with many producers and a single consumer.
+ *
+ *  Any number of threads may push() concurrently, but only one thread may pop(). Neither
+ *  operation ever blocks: push() fails when the queue is full and pop() fails when it is
+ *  empty. Each slot carries a sequence number which tells producers and the consumer whose
+ *  turn it is to use the slot, so no locks are needed.
+ */
+template <typename T>
+class CommandQueue
+{
+public:
+    /** Constructor
+     *
+     *  @param capacityInit the minimum number of items the queue can hold, this is rounded
+     *                      up to a power of two
+     */
+    explicit CommandQueue (std::size_t capacityInit)
+        : capacity (roundUpToPowerOfTwo (capacityInit)),
+          mask (capacity - 1),
+          slots (new Slot [capacity]),
+          enqueuePosition (0),
+          dequeuePosition (0)
+    {
+        for (std::size_t i = 0; i < capacity; ++i)
+        {
+            slots [i].sequence.store (i, std::memory_order_relaxed);
+        }
+    }
+
+    /** Destructor */
+    ~CommandQueue() = default;
+
+    /** Add an item to the queue. May be called from any thread.
+     *
+     *  Returns false, leaving the queue unchanged, if the queue is full.
+     *
+     *  @param item the item to add
+     */
+    bool push (const T &item)
+    {
+        std::size_t position = enqueuePosition.load (std::memory_order_relaxed);
+        Slot *slot = nullptr;
+
+        while (true)
+        {
+            slot = &slots [position & mask];
+            std::size_t sequence = slot->sequence.load (std::memory_order_acquire);
+            auto difference = static_cast <std::ptrdiff_t> (sequence - position);
+
+            if (difference == 0)
+            {
+                if (enqueuePosition.compare_exchange_weak (position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = enqueuePosition.load (std::memory_order_relaxed);
+            }
+        }
+
+        slot->item = item;
+        slot->sequence.store (position + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    /** Take the oldest item from the queue. Must only be called from the consumer thread.
+     *
+     *  Returns false, leaving item unchanged, if the queue is empty.
+     *
+     *  @param item set to the item taken from the queue
+     */
+    bool pop (T &item)
+    {
+        std::size_t position = dequeuePosition.load (std::memory_order_relaxed);
+        Slot &slot = slots [position & mask];
+        std::size_t sequence = slot.sequence.load (std::memory_order_acquire);
+
+        if (static_cast <std::ptrdiff_t> (sequence - (position + 1)) < 0)
+        {
+            return false;
+        }
+
+        item = std::move (slot.item);
+        slot.sequence.store (position + capacity, std::memory_order_release);
+        dequeuePosition.store (position + 1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    /** Returns the number of items the queue can hold. */
+    std::size_t getCapacity() const
+    {
+        return capacity;
+    }
+
+    /** Returns the number of items in the queue.
+     *
+     *  As producers may be pushing concurrently this is only a snapshot.
+     */
+    std::size_t getSize() const
+    {
+        std::size_t dequeued = dequeuePosition.load (std::memory_order_relaxed);
+        std::size_t enqueued = enqueuePosition.load (std::memory_order_relaxed);
+
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+private:
+    CommandQueue (const CommandQueue&) = delete;
+    CommandQueue& operator= (const CommandQueue&) = delete;
+
+    struct Slot
+    {
+        std::atomic <std::size_t> sequence;
+        T item;
+    };
+
+    /** Padding to keep the producer and consumer positions on separate cache lines. */
+    using CacheLinePadding = char [64];
+
+    const std::size_t capacity;
+    const std::size_t mask;
+    std::unique_ptr <Slot[]> slots;
+
+    CacheLinePadding producerPadding;
+    std::atomic <std::size_t> enqueuePosition;
+    CacheLinePadding consumerPadding;
+    std::atomic <std::size_t> dequeuePosition;
+
+    static std::size_t roundUpToPowerOfTwo (std::size_t value)
+    {
+        std::size_t powerOfTwo = 1;
+
+        while (powerOfTwo < value)
+        {
+            powerOfTwo <<= 1;
+        }
+
+        return powerOfTwo;
+    }
+};
+
+#endif // COMMAND_QUEUE_HPP_INCLUDED
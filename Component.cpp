@@ -1,48 +1,577 @@
 #include "Component.hpp"
+#include <algorithm>
+#include "Layout.hpp"
+#include "RepaintManager.hpp"
 
 Component::Component()
-    : window (Curses::getInstance().createWindow (0, 0, 0, 0))
+    : repaintPending (false),
+      positionX (0), positionY (0),
+      width (0), height (0),
+      visible (true),
+      lightweight (false),
+      opaque (false),
+      parent (nullptr),
+      layout (nullptr),
+      layoutPending (false),
+      awaitingExposure (false),
+      paintPass (0)
 {
 }
 
 Component::~Component()
 {
+    if (parent != nullptr)
+    {
+        parent->removeChildComponent (*this);
+    }
+
+    for (auto child : children)
+    {
+        child->parent = nullptr;
+    }
+
+    setLayout (nullptr);
+    RepaintManager::getInstance().removeComponent (*this);
 }
 
 void Component::redraw()
 {
-    window.clear();
-    Window::VideoAttributes attributeCache = window.getVideoAttributes();
-    draw (window);
-    window.setVideoAttributes (attributeCache);
-    Curses::getInstance().refreshScreen();
+    Curses::Lock lock;
+    Component *heavyweight = getHeavyweightAncestor();
+
+    if (heavyweight != nullptr)
+    {
+        heavyweight->paint();
+        Curses::getInstance().refreshScreen();
+    }
+}
+
+void Component::invalidate()
+{
+    // A lightweight component is repainted on its own, by redrawing just its area of its
+    // ancestor's window.
+    Component *dirty = lightweight ? this : getHeavyweightAncestor();
+
+    if (dirty != nullptr)
+    {
+        RepaintManager::getInstance().addDirtyComponent (*dirty);
+    }
+}
+
+void Component::keyPressed (int key, int repeatCount)
+{
+    for (int i = 0; i < repeatCount; ++i)
+    {
+        keyPressed (key);
+    }
+}
+
+Window& Component::getWindow()
+{
+    if (! window)
+    {
+        Window newWindow = Curses::getInstance().createWindow (getScreenX(), getScreenY(), width, height);
+        window.reset (new Window (std::move (newWindow)));
+        window->setUseCanvas (true);
+
+        // A new panel goes on top of the stack, so any children created earlier have to be
+        // raised back above it.
+        if (! isShowing())
+        {
+            window->hide();
+        }
+        else
+        {
+            for (auto child : children)
+            {
+                if (child->visible)
+                {
+                    child->bringToFront();
+                }
+            }
+        }
+    }
+
+    return *window;
+}
+
+Component* Component::getHeavyweightAncestor()
+{
+    Component *component = this;
+
+    while (component != nullptr && component->lightweight)
+    {
+        component = component->parent;
+    }
+
+    return component;
+}
+
+void Component::invalidateArea()
+{
+    // A lightweight component which moves or disappears leaves its old area behind in its
+    // parent's part of the window.
+    if (lightweight && parent != nullptr)
+    {
+        parent->invalidate();
+    }
+    else
+    {
+        invalidate();
+    }
+}
+
+bool Component::paint()
+{
+    if (lightweight)
+    {
+        return paintArea();
+    }
+
+    Window::DrawSession session (getWindow());
+
+    if (! restrictToVisibleBounds (session))
+    {
+        return false;
+    }
+
+    paintContents (session);
+    session.commit();
+
+    return true;
+}
+
+bool Component::paintArea()
+{
+    Component *heavyweight = getHeavyweightAncestor();
+
+    if (heavyweight == nullptr || ! isShowing())
+    {
+        return false;
+    }
+
+    // Find the area in the ancestor's window, cut down to each lightweight ancestor in
+    // between, as nothing is drawn outside them.
+    int left = 0;
+    int top = 0;
+    int right = width;
+    int bottom = height;
+
+    for (const Component *component = this; component != heavyweight; component = component->parent)
+    {
+        left = std::max (left, 0) + component->positionX;
+        top = std::max (top, 0) + component->positionY;
+        right = std::min (right, component->width) + component->positionX;
+        bottom = std::min (bottom, component->height) + component->positionY;
+    }
+
+    if (left >= right || top >= bottom)
+    {
+        return false;
+    }
+
+    Window::DrawSession session (heavyweight->getWindow());
+
+    if (! heavyweight->restrictToVisibleBounds (session))
+    {
+        return false;
+    }
+
+    session.restrictClip (left, top, right - left, bottom - top);
+
+    // An opaque component hides everything under it, so only it and whatever lies above
+    // it are drawn. Otherwise the ancestor is drawn again under the area, and then every
+    // lightweight component which reaches into it, so whatever overlaps this component
+    // still comes out on top.
+    if (opaque)
+    {
+        heavyweight->paintDescendant (session, *this);
+    }
+    else
+    {
+        heavyweight->paintContents (session);
+    }
+
+    session.commit();
+
+    return true;
+}
+
+bool Component::restrictToVisibleBounds (Window::DrawSession &session)
+{
+    int left, top, right, bottom;
+
+    // Only the part of the window not covered by other panels is drawn. Whatever is left
+    // out is drawn once the panels have moved.
+    if (! window->getVisibleBounds (left, top, right, bottom))
+    {
+        RepaintManager::getInstance().addHiddenComponent (*this);
+        return false;
+    }
+
+    if (left > 0 || top > 0 || right < width || bottom < height)
+    {
+        session.restrictClip (left, top, right - left, bottom - top);
+        RepaintManager::getInstance().addHiddenComponent (*this);
+    }
+
+    return true;
+}
+
+void Component::paintContents (Window::DrawSession &session)
+{
+    // An opaque component draws every cell of its area itself, so clearing it first would
+    // only throw away what is already there.
+    if (! opaque)
+    {
+        session.clear();
+    }
+
+    Window::VideoAttributes attributeCache = session.getVideoAttributes();
+    draw (session);
+    session.setVideoAttributes (attributeCache);
+    paintLightweightChildren (session);
+}
+
+void Component::paintDescendant (Window::DrawSession &session, Component &descendant)
+{
+    Component *child = &descendant;
+
+    while (child->parent != this)
+    {
+        child = child->parent;
+    }
+
+    std::size_t childIndex = std::find (children.begin(), children.end(), child) - children.begin();
+
+    {
+        Window::DrawSession childSession (session, child->positionX, child->positionY,
+                                          child->width, child->height);
+
+        if (child == &descendant)
+        {
+            child->paintContents (childSession);
+        }
+        else
+        {
+            child->paintDescendant (childSession, descendant);
+        }
+    }
+
+    // Lightweight children later in the list lie above the descendant.
+    paintLightweightChildren (session, childIndex + 1);
+}
+
+void Component::paintLightweightChildren (Window::DrawSession &session, std::size_t firstChild)
+{
+    for (std::size_t i = firstChild; i < children.size(); ++i)
+    {
+        Component *child = children [i];
+
+        if (! child->lightweight || ! child->visible
+            || ! session.isRegionVisible (child->positionX, child->positionY, child->width, child->height))
+        {
+            continue;
+        }
+
+        Window::DrawSession childSession (session, child->positionX, child->positionY,
+                                          child->width, child->height);
+        child->paintContents (childSession);
+    }
 }
 
 void Component::setBounds (int newX, int newY, int newWidth, int newHeight)
 {
-    window.resize (newX, newY, newWidth, newHeight);
+    bool boundsChanged = newX != positionX || newY != positionY
+                         || newWidth != width || newHeight != height;
+
+    if (lightweight && boundsChanged)
+    {
+        invalidateArea();
+    }
+
+    positionX = newX;
+    positionY = newY;
+    width = newWidth;
+    height = newHeight;
+
+    bool windowChanged = ! lightweight && getWindow().resize (getScreenX(), getScreenY(), width, height);
+
+    if (! boundsChanged && ! windowChanged)
+    {
+        return;
+    }
 
     resized();
-    redraw();
+    layOutChildren();
+
+    // Children placed by the layout are already in the right place, so this only moves
+    // the others.
+    for (auto child : children)
+    {
+        child->updateScreenPosition();
+    }
+
+    invalidate();
+}
+
+int Component::getX() const
+{
+    return positionX;
+}
+
+int Component::getY() const
+{
+    return positionY;
 }
 
 int Component::getWidth() const
 {
-    return window.getWidth();
+    return width;
 }
 
 int Component::getHeight() const
 {
-    return window.getHeight();
+    return height;
+}
+
+int Component::getScreenX() const
+{
+    return (parent != nullptr ? parent->getScreenX() : 0) + positionX;
+}
+
+int Component::getScreenY() const
+{
+    return (parent != nullptr ? parent->getScreenY() : 0) + positionY;
+}
+
+void Component::setLightweight (bool shouldBeLightweight)
+{
+    if (shouldBeLightweight == lightweight)
+    {
+        return;
+    }
+
+    Curses::Lock lock;
+
+    if (shouldBeLightweight)
+    {
+        window.reset();
+    }
+    else
+    {
+        invalidateArea();
+    }
+
+    lightweight = shouldBeLightweight;
+
+    if (isShowing())
+    {
+        bringToFront();
+    }
+}
+
+bool Component::isLightweight() const
+{
+    return lightweight;
+}
+
+void Component::setOpaque (bool shouldBeOpaque)
+{
+    opaque = shouldBeOpaque;
+}
+
+bool Component::isOpaque() const
+{
+    return opaque;
 }
 
 void Component::hide()
 {
-    window.hide();
+    if (lightweight)
+    {
+        invalidateArea();
+    }
+
+    visible = false;
+    hideWindows();
 }
 
 void Component::show()
 {
-    window.show();
-    redraw();
+    visible = true;
+
+    if (isShowing())
+    {
+        bringToFront();
+    }
+}
+
+bool Component::isVisible() const
+{
+    return visible;
+}
+
+void Component::addChildComponent (Component &child)
+{
+    if (child.parent == this)
+    {
+        return;
+    }
+
+    if (child.parent != nullptr)
+    {
+        child.parent->removeChildComponent (child);
+    }
+
+    child.parent = this;
+    children.push_back (&child);
+
+    child.updateScreenPosition();
+
+    if (child.isShowing())
+    {
+        child.bringToFront();
+    }
+    else
+    {
+        child.hideWindows();
+    }
+}
+
+void Component::removeChildComponent (Component &child)
+{
+    auto found = std::find (children.begin(), children.end(), &child);
+
+    if (found == children.end())
+    {
+        return;
+    }
+
+    child.invalidateArea();
+    children.erase (found);
+    child.parent = nullptr;
+
+    if (layout != nullptr)
+    {
+        layout->removeComponent (child);
+    }
+
+    child.updateScreenPosition();
+}
+
+Component* Component::getParentComponent() const
+{
+    return parent;
+}
+
+const std::vector <Component*>& Component::getChildComponents() const
+{
+    return children;
+}
+
+void Component::setLayout (Layout *newLayout)
+{
+    if (layout != nullptr)
+    {
+        layout->owner = nullptr;
+    }
+
+    layout = newLayout;
+
+    if (layout != nullptr)
+    {
+        layout->owner = this;
+        layout->constraintsChanged = true;
+        invalidateLayout();
+    }
+}
+
+Layout* Component::getLayout() const
+{
+    return layout;
+}
+
+void Component::invalidateLayout()
+{
+    RepaintManager::getInstance().addDirtyLayout (*this);
+}
+
+void Component::layOutChildren()
+{
+    if (layout != nullptr)
+    {
+        layout->apply (getWidth(), getHeight());
+    }
+}
+
+void Component::updateScreenPosition()
+{
+    // Lightweight components move with their ancestor's window, but may still have
+    // heavyweight children to move.
+    if (window && ! window->resize (getScreenX(), getScreenY(), width, height))
+    {
+        return;
+    }
+
+    for (auto child : children)
+    {
+        child->updateScreenPosition();
+    }
+}
+
+void Component::bringToFront()
+{
+    if (! lightweight)
+    {
+        getWindow().show();
+    }
+
+    invalidate();
+
+    for (auto child : children)
+    {
+        if (child->visible)
+        {
+            child->bringToFront();
+        }
+    }
+}
+
+void Component::hideWindows()
+{
+    if (window)
+    {
+        window->hide();
+    }
+
+    for (auto child : children)
+    {
+        child->hideWindows();
+    }
+}
+
+bool Component::isShowing() const
+{
+    for (const Component *component = this; component != nullptr; component = component->parent)
+    {
+        if (! component->visible)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int Component::getDepth() const
+{
+    int depth = 0;
+
+    for (const Component *component = parent; component != nullptr; component = component->parent)
+    {
+        ++depth;
+    }
+
+    return depth;
 }
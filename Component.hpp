@@ -1,8 +1,12 @@
 #ifndef COMPONENT_HPP_INCLUDED
 #define COMPONENT_HPP_INCLUDED
 
+#include <memory>
+#include <vector>
 #include "Curses.hpp"
 
+class Layout;
+
 class Component
 {
 public:
@@ -10,22 +14,80 @@ public:
     virtual ~Component();
 
     void redraw();
+    void invalidate();
 
     void setBounds (int newX, int newY, int newWidth, int newHeight);
 
+    int getX() const;
+    int getY() const;
     int getWidth() const;
     int getHeight() const;
+    int getScreenX() const;
+    int getScreenY() const;
+
+    void setLightweight (bool shouldBeLightweight);
+    bool isLightweight() const;
+
+    void setOpaque (bool shouldBeOpaque);
+    bool isOpaque() const;
 
     void hide();
     void show();
+    bool isVisible() const;
+
+    void addChildComponent (Component &child);
+    void removeChildComponent (Component &child);
+    Component* getParentComponent() const;
+    const std::vector <Component*>& getChildComponents() const;
+
+    void setLayout (Layout *newLayout);
+    Layout* getLayout() const;
+    void invalidateLayout();
 
     virtual void keyPressed (int key) = 0;
+    virtual void keyPressed (int key, int repeatCount);
 
 private:
-    Window window;
+    std::unique_ptr <Window> window;
+    bool repaintPending;
+
+    int positionX, positionY;
+    int width, height;
+    bool visible;
+    bool lightweight;
+    bool opaque;
+
+    Component *parent;
+    std::vector <Component*> children;
 
-    virtual void draw (Window &w) = 0;
+    Layout *layout;
+    bool layoutPending;
+
+    bool awaitingExposure;
+    unsigned long paintPass;
+
+    Window& getWindow();
+    Component* getHeavyweightAncestor();
+    void invalidateArea();
+
+    bool paint();
+    bool paintArea();
+    bool restrictToVisibleBounds (Window::DrawSession &session);
+    void paintContents (Window::DrawSession &session);
+    void paintDescendant (Window::DrawSession &session, Component &descendant);
+    void paintLightweightChildren (Window::DrawSession &session, std::size_t firstChild = 0);
+    void layOutChildren();
+
+    void updateScreenPosition();
+    void bringToFront();
+    void hideWindows();
+    bool isShowing() const;
+    int getDepth() const;
+
+    virtual void draw (Window::DrawSession &session) = 0;
     virtual void resized() = 0;
+
+    friend class RepaintManager;
 };
 
 #endif // COMPONENT_HPP_INCLUDED
@@ -1,39 +1,95 @@
 #include "Curses.hpp"
-#include <array>
+#include <algorithm>
+#include <clocale>
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include "MathsTools.hpp"
+#include "NcursesBackend.hpp"
 
-Curses::Curses()
+namespace
 {
-    initscr();
-    keypad (stdscr, true);
-    cbreak();
-    noecho();
-    start_color();
+    /** The number of measured strings to remember, which is plenty for a screen of labels. */
+    const std::size_t displayTextCapacity = 1024;
+
+    /** The backend to use when the Curses instance is created. */
+    std::unique_ptr <TerminalBackend> pendingBackend;
+    bool instanceCreated = false;
+
+    /** Returns the backend the Curses instance draws with.
+     *
+     *  Wide characters are measured and written with the terminal's character set, which
+     *  ncurses must have before it starts, so the locale is set here whichever backend is
+     *  used. Only the character type is taken from the environment, so numbers are still
+     *  formatted the same everywhere.
+     */
+    std::unique_ptr <TerminalBackend> takeBackend()
+    {
+        std::setlocale (LC_CTYPE, "");
+
+        if (pendingBackend)
+        {
+            return std::move (pendingBackend);
+        }
+
+        return std::unique_ptr <TerminalBackend> (new NcursesBackend());
+    }
 
-    std::array <Colour, 8> colours {{Colour::black,
-                                     Colour::red,
-                                     Colour::green,
-                                     Colour::yellow,
-                                     Colour::blue,
-                                     Colour::magenta,
-                                     Colour::cyan,
-                                     Colour::white}};
+    /** A rectangle of screen cells, with exclusive right and bottom edges. */
+    struct CellRectangle
+    {
+        int left, top, right, bottom;
+    };
 
-    for (auto background : colours)
+    /** Add the parts of a rectangle not covered by another rectangle to a list. */
+    void subtractRectangle (const CellRectangle &area, const CellRectangle &cover,
+                            std::vector <CellRectangle> &remainder)
     {
-        for (auto foreground : colours)
+        if (cover.left >= area.right || cover.right <= area.left
+            || cover.top >= area.bottom || cover.bottom <= area.top)
+        {
+            remainder.push_back (area);
+            return;
+        }
+
+        int middleTop = std::max (area.top, cover.top);
+        int middleBottom = std::min (area.bottom, cover.bottom);
+
+        if (area.top < middleTop)
+        {
+            remainder.push_back (CellRectangle {area.left, area.top, area.right, middleTop});
+        }
+
+        if (middleBottom < area.bottom)
+        {
+            remainder.push_back (CellRectangle {area.left, middleBottom, area.right, area.bottom});
+        }
+
+        if (area.left < cover.left)
+        {
+            remainder.push_back (CellRectangle {area.left, middleTop, cover.left, middleBottom});
+        }
+
+        if (cover.right < area.right)
         {
-            ColourPair pairIndex = getColourPairIndex (background, foreground);
-            init_pair (pairIndex, static_cast <short> (foreground), static_cast <short> (background));
+            remainder.push_back (CellRectangle {cover.right, middleTop, area.right, middleBottom});
         }
     }
 }
 
+Curses::Curses()
+    : panelStackVersion (0),
+      backend (takeBackend()),
+      displayTexts (displayTextCapacity)
+{
+    instanceCreated = true;
+
+    // Pair 0 is the terminal's default and cannot be changed.
+    colourPairs.reset (new ColourPairCache (*backend, std::max (backend->getNumColourPairs() - 1, 0)));
+}
+
 Curses::~Curses()
 {
-    endwin();
 }
 
 Curses::Instance Curses::getInstance()
@@ -42,35 +98,99 @@ Curses::Instance Curses::getInstance()
     return instance;
 }
 
+bool Curses::setBackend (std::unique_ptr <TerminalBackend> newBackend)
+{
+    if (instanceCreated)
+    {
+        return false;
+    }
+
+    pendingBackend = std::move (newBackend);
+    return true;
+}
+
+TerminalBackend& Curses::getBackend()
+{
+    return *backend;
+}
+
 Window Curses::createWindow (int x, int y, int width, int height)
 {
+    Lock lock;
     return Window (x, y, width, height);
 }
 
 int Curses::getScreenWidth() const
 {
-    return COLS;
+    return backend->getScreenWidth();
 }
 
 int Curses::getScreenHeight() const
 {
-    return LINES;
+    return backend->getScreenHeight();
+}
+
+bool Curses::updateScreenSize()
+{
+    Lock lock;
+
+    if (! backend->updateScreenSize())
+    {
+        return false;
+    }
+
+    ++panelStackVersion;
+    return true;
+}
+
+int Curses::getNumColours() const
+{
+    return backend->getNumColours();
 }
 
 Curses::ColourPair Curses::getColourPairIndex (Colour backgroundColour, Colour foregroundColour)
 {
-    return static_cast <short> (backgroundColour) + static_cast <short> (foregroundColour) * 8 + 1;
+    Lock lock;
+    return colourPairs->getPair (static_cast <short> (foregroundColour), static_cast <short> (backgroundColour));
+}
+
+ColourPairCache::Statistics Curses::getColourPairStatistics() const
+{
+    std::lock_guard <std::recursive_mutex> lock (protectionMutex);
+    return colourPairs->getStatistics();
+}
+
+int Curses::getTextWidth (const std::string &text)
+{
+    Lock lock;
+    return displayTexts.getWidth (text);
+}
+
+DisplayTextCache::Statistics Curses::getDisplayTextStatistics() const
+{
+    std::lock_guard <std::recursive_mutex> lock (protectionMutex);
+    return displayTexts.getStatistics();
 }
 
 void Curses::setCursor (Cursor newCursor)
 {
-    curs_set (static_cast <int> (newCursor));
+    backend->setCursorVisibility (static_cast <int> (newCursor));
 }
 
 void Curses::refreshScreen()
 {
-    update_panels();
-    doupdate();
+    backend->refresh();
+}
+
+int Curses::readKey()
+{
+    Lock lock;
+    return backend->readKey();
+}
+
+unsigned long Curses::getPanelStackVersion() const
+{
+    return panelStackVersion;
 }
 
 Curses::Lock::Lock()
@@ -83,344 +203,1591 @@ Curses::Lock::~Lock()
 }
 
 Window::Window (int x, int y, int widthInit, int heightInit)
-    : width (widthInit), height (heightInit),
-      window (newwin (height, width, y, x), delwin),
-      panel (new_panel (window.get()), del_panel),
+    : positionX (x), positionY (y),
+      width (widthInit), height (heightInit),
+      window (Curses::getInstance().backend->createWindow (x, y, std::max (width, 1), std::max (height, 1))),
       backgroundColour (Curses::Colour::black),
-      foregroundColour (Curses::Colour::white)
+      foregroundColour (Curses::Colour::white),
+      attributes (A_NORMAL), colourPair (0), colourPairGeneration (0),
+      appliedAttributes (A_NORMAL), appliedColourPair (0),
+      attributeRequests (0), attributeLibraryCalls (0),
+      contentVersion (0)
 {
+    resetView();
     setColours (backgroundColour, foregroundColour);
+    ++Curses::getInstance().panelStackVersion;
 }
 
 Window::Window (Window &&other)
-    : width (other.width), height (other.height),
+    : positionX (other.positionX), positionY (other.positionY),
+      width (other.width), height (other.height),
+      view (other.view),
       window (std::move (other.window)),
-      panel (new_panel (window.get()), del_panel),
       backgroundColour (other.backgroundColour),
-      foregroundColour (other.foregroundColour)
+      foregroundColour (other.foregroundColour),
+      attributes (other.attributes), colourPair (other.colourPair),
+      colourPairGeneration (other.colourPairGeneration),
+      appliedAttributes (other.appliedAttributes), appliedColourPair (other.appliedColourPair),
+      attributeRequests (other.attributeRequests), attributeLibraryCalls (other.attributeLibraryCalls),
+      canvas (std::move (other.canvas)),
+      contentVersion (other.contentVersion + 1)
 {
+    Curses::Lock lock;
+    ++Curses::getInstance().panelStackVersion;
 }
 
 Window& Window::operator= (Window &&rhs)
 {
+    Curses::Lock lock;
+
+    positionX = rhs.positionX;
+    positionY = rhs.positionY;
     width = rhs.width;
     height = rhs.height;
+    view = rhs.view;
 
     window = std::move (rhs.window);
-    panel = Curses::PanelPointer (new_panel (window.get()), del_panel);
 
     backgroundColour = rhs.backgroundColour;
     foregroundColour = rhs.foregroundColour;
 
+    attributes = rhs.attributes;
+    colourPair = rhs.colourPair;
+    colourPairGeneration = rhs.colourPairGeneration;
+    appliedAttributes = rhs.appliedAttributes;
+    appliedColourPair = rhs.appliedColourPair;
+    attributeRequests = rhs.attributeRequests;
+    attributeLibraryCalls = rhs.attributeLibraryCalls;
+
+    canvas = std::move (rhs.canvas);
+    contentVersion = std::max (contentVersion, rhs.contentVersion) + 1;
+
+    ++Curses::getInstance().panelStackVersion;
     return *this;
 }
 
 Window::~Window()
 {
+    if (window)
+    {
+        Curses::Lock lock;
+        ++Curses::getInstance().panelStackVersion;
+    }
 }
 
 void Window::move (int x, int y)
 {
     Curses::Lock lock;
-    move_panel (panel.get(), y, x);
+    window->move (x, y);
+    ++Curses::getInstance().panelStackVersion;
+
+    positionX = x;
+    positionY = y;
 }
 
-void Window::resize (int x, int y, int newWidth, int newHeight)
+bool Window::resize (int x, int y, int newWidth, int newHeight)
 {
     Curses::Lock lock;
-    Curses::WindowPointer tempWindow (newwin (height, newWidth, y, x), delwin);
-    replace_panel (panel.get(), tempWindow.get());
-    window = std::move (tempWindow);
 
+    // ncurses windows can not be empty, so empty windows are kept one cell in size.
+    int windowWidth = std::max (newWidth, 1);
+    int windowHeight = std::max (newHeight, 1);
+
+    int currentX = window->getX();
+    int currentY = window->getY();
+    int currentWidth = window->getWidth();
+    int currentHeight = window->getHeight();
+
+    bool sizeChanged = newWidth != width || newHeight != height;
+    bool boundsChanged = sizeChanged || x != positionX || y != positionY;
+    bool windowResized = windowWidth != currentWidth || windowHeight != currentHeight;
+    bool windowChanged = windowResized || x != currentX || y != currentY;
+
+    if (windowChanged)
+    {
+        window->setBounds (x, y, windowWidth, windowHeight);
+        ++Curses::getInstance().panelStackVersion;
+    }
+
+    positionX = x;
+    positionY = y;
     width = newWidth;
     height = newHeight;
+
+    if (! view.active)
+    {
+        resetView();
+    }
+
+    if (sizeChanged || windowResized)
+    {
+        ++contentVersion;
+    }
+
+    // A window's contents move with it, so the canvas only needs to change with its size.
+    if (canvas)
+    {
+        if (sizeChanged)
+        {
+            canvas->resize (width, height);
+        }
+        else if (windowResized)
+        {
+            canvas->invalidate();
+        }
+    }
+
+    return boundsChanged || windowChanged;
 }
 
 void Window::hide()
 {
     Curses::Lock lock;
-    hide_panel (panel.get());
+    window->hide();
+    ++Curses::getInstance().panelStackVersion;
 }
 
 void Window::show()
 {
     Curses::Lock lock;
-    show_panel (panel.get());
+    window->show();
+    ++Curses::getInstance().panelStackVersion;
 }
 
 void Window::printCharacter (const chtype character)
 {
-    Curses::Lock lock;
-    waddch (window.get(), character);
+    DrawSession (*this).printCharacter (character);
 }
 
 void Window::printCharacter (const chtype character, int x, int y)
 {
-    Curses::Lock lock;
-    mvwaddch (window.get(), y, x, character);
+    DrawSession (*this).printCharacter (character, x, y);
 }
 
 void Window::printString (const std::string &string)
 {
-    Curses::Lock lock;
-    waddstr (window.get(), string.c_str());
+    DrawSession (*this).printString (string);
 }
 
 void Window::printString (const std::string &string, int x, int y)
 {
-    Curses::Lock lock;
-    mvwaddstr (window.get(), y, x, string.c_str());
+    DrawSession (*this).printString (string, x, y);
 }
 
-void Window::printDouble (double value)
+void Window::printDouble (double value, const NumberFormat &format)
 {
-    Curses::Lock lock;
-    wprintw (window.get(), "%.2f", value);
+    DrawSession (*this).printDouble (value, format);
 }
 
-void Window::printDouble (double value, int x, int y)
+void Window::printDouble (double value, int x, int y, const NumberFormat &format)
 {
-    Curses::Lock lock;
-    mvwprintw (window.get(), y, x, "%.2f", value);
+    DrawSession (*this).printDouble (value, x, y, format);
 }
 
-void Window::printInteger (int value)
+void Window::printInteger (int value, const NumberFormat &format)
 {
-    Curses::Lock lock;
-    wprintw (window.get(), "%d", value);
+    DrawSession (*this).printInteger (value, format);
 }
 
-void Window::printInteger (int value, int x, int y)
+void Window::printInteger (int value, int x, int y, const NumberFormat &format)
 {
-    Curses::Lock lock;
-    mvwprintw (window.get(), y, x, "%d", value);
+    DrawSession (*this).printInteger (value, x, y, format);
 }
 
 void Window::drawLine (int startX, int startY, int endX, int endY, const chtype character)
 {
-    int xRange = endX - startX;
-    int yRange = endY - startY;
-
-    int x = startX;
-    int y = startY;
-
-    int *iterationDimension = nullptr;
-    int iterationEnd = 0;
-    int iterationIncrement = 0;
+    DrawSession (*this).drawLine (startX, startY, endX, endY, character);
+}
 
-    int *otherDimension = nullptr;
-    double otherDimensionDouble = 0.0;
-    double otherIncrement = 0.0;
+void Window::drawHorizontalLine (int startX, int endX, int y, const chtype character)
+{
+    y += view.originY;
+    startX = std::max (startX + view.originX, view.clipLeft);
+    endX = std::min (endX + view.originX, view.clipRight - 1);
 
-    if (abs (xRange) >= abs (yRange))
+    if (y < view.clipTop || y >= view.clipBottom || startX > endX)
     {
-        iterationDimension = &x;
-        iterationEnd = endX;
-        iterationIncrement = MathsTools::sign (xRange);
+        return;
+    }
 
-        otherDimension = &y;
-        otherDimensionDouble = static_cast <double> (y);
-        otherIncrement = static_cast <double> (yRange) / static_cast <double> (abs (xRange));
+    if (canvas)
+    {
+        canvas->fillCells (renderCharacter (character), endX - startX + 1, startX, y);
     }
     else
     {
-        iterationDimension = &y;
-        iterationEnd = endY;
-        iterationIncrement = MathsTools::sign (yRange);
-
-        otherDimension = &x;
-        otherDimensionDouble = static_cast <double> (x);
-        otherIncrement = static_cast <double> (xRange) / static_cast <double> (abs (yRange));
+        applyAttributes();
+        window->drawHorizontalLine (character, startX, y, endX - startX + 1);
     }
+}
 
-    if (iterationIncrement == 0)
+void Window::drawVerticalLine (int x, int startY, int endY, const chtype character)
+{
+    x += view.originX;
+    startY = std::max (startY + view.originY, view.clipTop);
+    endY = std::min (endY + view.originY, view.clipBottom - 1);
+
+    if (x < view.clipLeft || x >= view.clipRight || startY > endY)
     {
-        iterationIncrement = 1;
+        return;
     }
 
-    Curses::Lock lock;
+    if (canvas)
+    {
+        chtype renderedCharacter = renderCharacter (character);
 
-    for (; *iterationDimension != iterationEnd + iterationIncrement; *iterationDimension += iterationIncrement)
+        for (int y = startY; y <= endY; ++y)
+        {
+            canvas->setCell (renderedCharacter, x, y);
+        }
+    }
+    else
     {
-        printCharacter (character, x, y);
-        otherDimensionDouble += otherIncrement;
-        *otherDimension = round (otherDimensionDouble);
+        applyAttributes();
+        window->drawVerticalLine (character, x, startY, endY - startY + 1);
     }
 }
 
 void Window::drawEllipse (int x, int y, int width, int height, const chtype character)
 {
-    int alteredWidth = width - 1;
-    int alteredHeight = height - 1;
-
-    int plotX = 0;
-    int plotY = 0;
-
-    int *iterationDimension = nullptr;
-    int *otherDimension = nullptr;
+    DrawSession (*this).drawEllipse (x, y, width, height, character);
+}
 
-    double iterationScale = 0.0;
-    double iterationOffset = 0.0;
+void Window::fillEllipse (int x, int y, int width, int height, const chtype character)
+{
+    DrawSession (*this).fillEllipse (x, y, width, height, character);
+}
 
-    double otherScale = 0.0;
-    double otherOffset = 0.0;
+void Window::rasteriseEllipse (int x, int y, int width, int height, const chtype character, bool filled)
+{
+    int clipLeft = view.clipLeft - view.originX;
+    int clipTop = view.clipTop - view.originY;
+    int clipRight = view.clipRight - view.originX;
+    int clipBottom = view.clipBottom - view.originY;
 
-    if (alteredWidth >= alteredHeight)
+    if (width <= 0 || height <= 0
+        || x >= clipRight || x + width <= clipLeft || y >= clipBottom || y + height <= clipTop)
     {
-        iterationDimension = &plotX;
-        otherDimension = &plotY;
-
-        iterationScale = alteredWidth / 2.0;
-        iterationOffset = x + iterationScale;
-
-        otherScale = alteredHeight / 2.0;
-        otherOffset = y + otherScale;
+        return;
     }
-    else
+
+    // Midpoint ellipse inscribed in the cells [x, x + width - 1] by [y, y + height - 1].
+    // The four quadrants are walked together from the middle row outwards, so each
+    // perimeter cell is visited once and even sizes get a two cell wide centre.
+    long long diameterX = width - 1;
+    long long diameterY = height - 1;
+    long long oddHeight = diameterY & 1;
+
+    long long xStep = 4 * (1 - diameterX) * diameterY * diameterY;
+    long long yStep = 4 * (oddHeight + 1) * diameterX * diameterX;
+    long long error = xStep + yStep + oddHeight * diameterX * diameterX;
+
+    long long xStepIncrement = 8 * diameterY * diameterY;
+    long long yStepIncrement = 8 * diameterX * diameterX;
+
+    int left = x;
+    int right = x + width - 1;
+    int bottom = y + static_cast <int> ((diameterY + 1) / 2);
+    int top = bottom - static_cast <int> (oddHeight);
+
+    auto plotCell = [this, character, clipLeft, clipTop, clipRight, clipBottom] (int cellX, int cellY)
+                    {
+                        if (cellX >= clipLeft && cellX < clipRight && cellY >= clipTop && cellY < clipBottom)
+                        {
+                            emitCharacter (character, cellX, cellY);
+                        }
+                    };
+
+    auto plotRows = [this, character, filled, &plotCell] (int rowLeft, int rowRight, int rowTop, int rowBottom)
+                    {
+                        if (filled)
+                        {
+                            drawHorizontalLine (rowLeft, rowRight, rowTop, character);
+
+                            if (rowBottom != rowTop)
+                            {
+                                drawHorizontalLine (rowLeft, rowRight, rowBottom, character);
+                            }
+
+                            return;
+                        }
+
+                        plotCell (rowLeft, rowTop);
+
+                        if (rowRight != rowLeft)
+                        {
+                            plotCell (rowRight, rowTop);
+                        }
+
+                        if (rowBottom != rowTop)
+                        {
+                            plotCell (rowLeft, rowBottom);
+
+                            if (rowRight != rowLeft)
+                            {
+                                plotCell (rowRight, rowBottom);
+                            }
+                        }
+                    };
+
+    // A filled row only needs painting the first time it is reached, as that is when
+    // it is at its widest.
+    bool rowPainted = false;
+
+    do
     {
-        iterationDimension = &plotY;
-        otherDimension = &plotX;
+        // Rows only ever move outwards, so once both are outside the clip region nothing
+        // else can be seen.
+        if (top < clipTop && bottom >= clipBottom)
+        {
+            return;
+        }
 
-        iterationScale = alteredHeight / 2.0;
-        iterationOffset = y + iterationScale;
+        if (! (filled && rowPainted))
+        {
+            plotRows (left, right, top, bottom);
+            rowPainted = true;
+        }
 
-        otherScale = alteredWidth / 2.0;
-        otherOffset = x + otherScale;
-    }
+        long long doubleError = 2 * error;
 
-    double iterationIncrement = 1.0 / (width * height);
+        if (doubleError <= yStep)
+        {
+            ++bottom;
+            --top;
+            yStep += yStepIncrement;
+            error += yStep;
+            rowPainted = false;
+        }
 
-    Curses::Lock lock;
+        if (doubleError >= xStep || 2 * error > yStep)
+        {
+            ++left;
+            --right;
+            xStep += xStepIncrement;
+            error += xStep;
+        }
+    }
+    while (left <= right);
 
-    for (double i = 0.0; i <= 1.0; i += iterationIncrement / 2.0)
+    // Very flat ellipses leave the loop before reaching their top and bottom rows. If the
+    // loop ended without stepping outwards, the rows it stopped on are already drawn.
+    if (rowPainted)
     {
-        auto printCircleLine = [iterationDimension,
-                                iterationScale, iterationOffset, 
-                                otherDimension,
-                                otherScale, otherOffset,
-                                &plotX, &plotY,
-                                character,
-                                this] (double xValue)
-                               {
-                                   *iterationDimension = round (xValue * iterationScale + iterationOffset);
-
-                                   double circleLine = pow (1 - xValue * xValue, 0.5);
-
-                                   *otherDimension = round (circleLine * otherScale + otherOffset);
-                                   printCharacter (character, plotX, plotY);
+        --top;
+        ++bottom;
+    }
 
-                                   *otherDimension = round (-circleLine * otherScale + otherOffset);
-                                   printCharacter (character, plotX, plotY);
-                               };
-    
-        printCircleLine (i);
-        printCircleLine (-i);
+    while (bottom - top <= diameterY && (top >= clipTop || bottom < clipBottom))
+    {
+        plotRows (left - 1, right + 1, top--, bottom++);
     }
 }
 
 void Window::drawBox (int x, int y, int width, int height)
 {
-    Curses::Lock lock;
-    int rightX = x + width - 1;
-    int bottomY = y + height - 1;
-    printCharacter (ACS_ULCORNER, x, y);
-    printCharacter (ACS_LLCORNER, x, bottomY);
-    printCharacter (ACS_URCORNER, rightX, y);
-    printCharacter (ACS_LRCORNER, rightX, bottomY);
+    DrawSession (*this).drawBox (x, y, width, height);
+}
 
-    int horizontalStart = x + 1;
-    int horizontalEnd = rightX - 1;
-    drawLine (horizontalStart, y, horizontalEnd, y, ACS_HLINE);
-    drawLine (horizontalStart, bottomY, horizontalEnd, bottomY, ACS_HLINE);
+void Window::fillRect (int x, int y, int rectWidth, int rectHeight, const chtype character)
+{
+    DrawSession (*this).fillRect (x, y, rectWidth, rectHeight, character);
+}
 
-    int verticalStart = y + 1;
-    int verticalEnd = bottomY - 1;
-    drawLine (x, verticalStart, x, verticalEnd, ACS_VLINE);
-    drawLine (rightX, verticalStart, rightX, verticalEnd, ACS_VLINE);
+void Window::fillAll (const chtype character)
+{
+    DrawSession (*this).fillAll (character);
 }
 
-void Window::fillAll(const chtype character)
+void Window::emitCharacter (const chtype character)
 {
-    Curses::Lock lock;
+    if (! view.active)
+    {
+        if (isClipRestricted())
+        {
+            emitWrappedCharacter (character);
+        }
+        else
+        {
+            putCharacter (character);
+        }
+
+        return;
+    }
 
-    for (int x = 0; x < width; ++x)
+    if (view.cursorX >= view.clipLeft && view.cursorX < view.clipRight
+        && view.cursorY >= view.clipTop && view.cursorY < view.clipBottom)
     {
-        drawLine (x, 0, x, height - 1, character);
+        putCharacter (character, view.cursorX, view.cursorY);
     }
-}
 
-void Window::clear()
-{
-    Curses::Lock lock;
-    werase (window.get());
+    ++view.cursorX;
 }
 
-int Window::getWidth() const
+void Window::emitCharacter (const chtype character, int x, int y)
 {
-    return width;
-}
+    x += view.originX;
+    y += view.originY;
 
-int Window::getHeight() const
-{
-    return height;
+    if (! view.active)
+    {
+        if (isClipRestricted())
+        {
+            placeCursor (x, y);
+            emitWrappedCharacter (character);
+        }
+        else
+        {
+            putCharacter (character, x, y);
+        }
+
+        return;
+    }
+
+    view.cursorX = x;
+    view.cursorY = y;
+    emitCharacter (character);
 }
 
-Window::VideoAttributes Window::getVideoAttributes() const
+void Window::emitString (const char *string, int length)
 {
-    Curses::Lock lock;
-    VideoAttributes attributes;
-    wattr_get (window.get(), &attributes.attributes, &attributes.colourPair, nullptr);
+    if (! view.active)
+    {
+        int x, y;
+
+        if (! isClipRestricted())
+        {
+            putString (string, length);
+        }
+        else if (getCursorPosition (x, y))
+        {
+            emitWrappedString (string, length, x, y);
+        }
+
+        return;
+    }
 
-    return attributes;
+    emitClippedString (string, length, view.cursorX, view.cursorY);
 }
 
-void Window::setVideoAttributes (const VideoAttributes &attributes)
+void Window::emitString (const char *string, int length, int x, int y)
 {
-    Curses::Lock lock;
-    wattr_set (window.get(), attributes.attributes, attributes.colourPair, nullptr);
+    x += view.originX;
+    y += view.originY;
+
+    if (! view.active)
+    {
+        if (isClipRestricted())
+        {
+            emitWrappedString (string, length, x, y);
+        }
+        else
+        {
+            putString (string, length, x, y);
+        }
+
+        return;
+    }
+
+    emitClippedString (string, length, x, y);
 }
 
-void Window::setBackgroundColour (Curses::Colour newBackgroundColour)
+void Window::emitClippedString (const char *string, int length, int x, int y)
 {
-    setColours (newBackgroundColour, foregroundColour);
+    int start = std::max (x, view.clipLeft);
+    int end = std::min (x + length, view.clipRight);
+
+    if (y >= view.clipTop && y < view.clipBottom && start < end)
+    {
+        putString (string + (start - x), end - start, start, y);
+    }
+
+    view.cursorX = x + length;
+    view.cursorY = y;
 }
 
-void Window::setForegroundColour (Curses::Colour newForegroundColour)
+void Window::emitText (const std::string &text)
 {
-    setColours (backgroundColour, newForegroundColour);
+    if (DisplayTextCache::isAscii (text.data(), text.size()))
+    {
+        emitString (text.data(), text.size());
+        return;
+    }
+
+    int x = view.cursorX;
+    int y = view.cursorY;
+
+    if (! view.active)
+    {
+        getCursorPosition (x, y);
+    }
+
+    emitDisplayText (Curses::getInstance().displayTexts.getDisplayText (text), x, y);
 }
 
-void Window::setColours (Curses::Colour newBackgroundColour, Curses::Colour newForegroundColour)
+void Window::emitText (const std::string &text, int x, int y)
 {
-    backgroundColour = newBackgroundColour;
-    foregroundColour = newForegroundColour;
+    if (DisplayTextCache::isAscii (text.data(), text.size()))
+    {
+        emitString (text.data(), text.size(), x, y);
+        return;
+    }
 
-    Curses::Lock lock;
-    wattron (window.get(), COLOR_PAIR (Curses::getInstance().getColourPairIndex (backgroundColour, foregroundColour)));
+    emitDisplayText (Curses::getInstance().displayTexts.getDisplayText (text), x + view.originX, y + view.originY);
 }
 
-void Window::setBold (bool setting)
+void Window::emitDisplayText (const DisplayText &text, int x, int y)
 {
-    Curses::Lock lock;
-    if (setting)
+    int left = view.clipLeft;
+    int top = view.clipTop;
+    int right = view.clipRight;
+    int bottom = view.clipBottom;
+
+    if (y >= top && y < bottom)
+    {
+        wideBuffer.clear();
+        int runStart = -1;
+        int column = x;
+        const wchar_t *marks = text.combiningMarks.data();
+
+        for (std::size_t i = 0; i < text.characters.size() && column < right; ++i)
+        {
+            int characterWidth = text.widths [i];
+            int characterEnd = column + characterWidth;
+            int numMarks = text.markCounts [i];
+
+            if (characterEnd > left)
+            {
+                // A character cut in two by the clip region leaves blanks in the part shown.
+                bool whole = column >= left && characterEnd <= right;
+                wchar_t character = whole ? text.characters [i] : L' ';
+                int cellsWritten = whole ? 1 : std::min (characterEnd, right) - std::max (column, left);
+                int cellWidth = whole ? characterWidth : 1;
+                int cellMarks = whole ? numMarks : 0;
+
+                for (int cell = 0; cell < cellsWritten; ++cell)
+                {
+                    int cellX = whole ? column : std::max (column, left) + cell;
+
+                    if (runStart < 0)
+                    {
+                        runStart = cellX;
+                    }
+
+                    if (canvas)
+                    {
+                        canvas->setWideCell (character, marks, cellMarks, cellWidth, attributes, colourPair,
+                                             cellX, y);
+                    }
+                    else
+                    {
+                        // The character is followed by its combining marks and then a null.
+                        wchar_t characterText [DisplayText::maxCombiningMarks + 2] = {character};
+                        std::copy (marks, marks + cellMarks, characterText + 1);
+                        cchar_t cell;
+                        setcchar (&cell, characterText, attributes, colourPair, nullptr);
+                        wideBuffer.push_back (cell);
+                    }
+                }
+            }
+
+            column = characterEnd;
+            marks += numMarks;
+        }
+
+        if (! canvas && runStart >= 0)
+        {
+            window->setWideCells (wideBuffer.data(), static_cast <int> (wideBuffer.size()), runStart, y);
+        }
+    }
+
+    int endX = x + text.width;
+
+    if (view.active)
     {
-        wattron (window.get(), A_BOLD);
+        view.cursorX = endX;
+        view.cursorY = y;
     }
     else
     {
-        wattroff (window.get(), A_BOLD);
+        placeCursor (std::min (endX, width - 1), y);
     }
 }
 
-void Window::setUnderline (bool setting)
+void Window::emitWrappedCharacter (const chtype character)
 {
-    Curses::Lock lock;
-    if (setting)
+    int x, y;
+
+    if (! getCursorPosition (x, y))
     {
-        wattron (window.get(), A_UNDERLINE);
+        return;
     }
-    else
+
+    if (x >= view.clipLeft && x < view.clipRight && y >= view.clipTop && y < view.clipBottom)
+    {
+        putCharacter (character, x, y);
+    }
+
+    if (++x >= width && y < height - 1)
+    {
+        x = 0;
+        ++y;
+    }
+
+    placeCursor (std::min (x, width - 1), y);
+}
+
+void Window::emitWrappedString (const char *string, int length, int x, int y)
+{
+    // As with wmove, a position outside the window prints nothing.
+    if (x < 0 || x >= width || y < 0 || y >= height)
     {
-        wattroff (window.get(), A_UNDERLINE);
+        return;
     }
+
+    while (length > 0)
+    {
+        int rowLength = std::min (length, width - x);
+        int start = std::max (x, view.clipLeft);
+        int end = std::min (x + rowLength, view.clipRight);
+
+        if (y >= view.clipTop && y < view.clipBottom && start < end)
+        {
+            putString (string + (start - x), end - start, start, y);
+        }
+
+        string += rowLength;
+        length -= rowLength;
+        x += rowLength;
+
+        if (x < width)
+        {
+            break;
+        }
+
+        // Without scrolling, ncurses stops at the bottom right corner.
+        if (y == height - 1)
+        {
+            x = width - 1;
+            break;
+        }
+
+        x = 0;
+        ++y;
+    }
+
+    placeCursor (x, y);
+}
+
+bool Window::isClipRestricted() const
+{
+    return view.clipLeft > 0 || view.clipTop > 0 || view.clipRight < width || view.clipBottom < height;
+}
+
+bool Window::getCursorPosition (int &x, int &y) const
+{
+    x = canvas ? canvas->getCursorX() : window->getCursorX();
+    y = canvas ? canvas->getCursorY() : window->getCursorY();
+
+    return x >= 0 && y >= 0;
+}
+
+void Window::placeCursor (int x, int y)
+{
+    if (canvas)
+    {
+        canvas->moveCursor (x, y);
+    }
+    else
+    {
+        window->moveCursor (x, y);
+    }
+}
+
+void Window::emitCells (const chtype *characters, int length, int x, int y)
+{
+    x += view.originX;
+    y += view.originY;
+
+    int start = std::max (x, view.clipLeft);
+    int end = std::min (x + length, view.clipRight);
+
+    if (y < view.clipTop || y >= view.clipBottom || start >= end)
+    {
+        return;
+    }
+
+    characters += start - x;
+    length = end - start;
+    x = start;
+
+    if (canvas)
+    {
+        canvas->setCells (characters, length, x, y);
+    }
+    else
+    {
+        window->setCells (characters, length, x, y);
+    }
+}
+
+void Window::putCharacter (const chtype character)
+{
+    if (canvas)
+    {
+        canvas->printCharacter (renderCharacter (character));
+    }
+    else
+    {
+        applyAttributes();
+        window->addCharacter (character);
+    }
+}
+
+void Window::putCharacter (const chtype character, int x, int y)
+{
+    if (canvas)
+    {
+        canvas->moveCursor (x, y);
+        canvas->printCharacter (renderCharacter (character));
+    }
+    else
+    {
+        applyAttributes();
+        window->addCharacter (character, x, y);
+    }
+}
+
+void Window::putString (const char *string, int length)
+{
+    if (canvas)
+    {
+        for (int i = 0; i < length; ++i)
+        {
+            canvas->printCharacter (renderCharacter (static_cast <unsigned char> (string [i])));
+        }
+    }
+    else
+    {
+        applyAttributes();
+        window->addString (string, length);
+    }
+}
+
+void Window::putString (const char *string, int length, int x, int y)
+{
+    if (canvas)
+    {
+        canvas->moveCursor (x, y);
+        putString (string, length);
+    }
+    else
+    {
+        applyAttributes();
+        window->addString (string, length, x, y);
+    }
+}
+
+void Window::resetView()
+{
+    view = DrawSession::ViewState {0, 0, width, height, 0, 0, width, height, 0, 0, false};
+}
+
+chtype Window::renderCharacter (const chtype character) const
+{
+    chtype windowAttributes = attributes | COLOR_PAIR (colourPair);
+
+    if ((character & A_COLOR) != 0)
+    {
+        windowAttributes &= ~A_COLOR;
+    }
+
+    return character | windowAttributes;
+}
+
+void Window::requestAttributes (attr_t newAttributes, short newColourPair)
+{
+    ++attributeRequests;
+    attributes = newAttributes;
+    colourPair = newColourPair;
+}
+
+short Window::lookUpColourPair()
+{
+    Curses &curses = Curses::getInstance();
+    short pair = curses.getColourPairIndex (backgroundColour, foregroundColour);
+    colourPairGeneration = curses.colourPairs->getGeneration();
+    return pair;
+}
+
+void Window::refreshColourPair()
+{
+    if (colourPairGeneration != Curses::getInstance().colourPairs->getGeneration())
+    {
+        colourPair = lookUpColourPair();
+    }
+}
+
+void Window::applyAttributes()
+{
+    if (attributes != appliedAttributes || colourPair != appliedColourPair)
+    {
+        window->setAttributes (attributes, colourPair);
+        appliedAttributes = attributes;
+        appliedColourPair = colourPair;
+        ++attributeLibraryCalls;
+    }
+}
+
+void Window::clear()
+{
+    DrawSession (*this).clear ();
+}
+
+void Window::clearRect (int x, int y, int rectWidth, int rectHeight)
+{
+    DrawSession (*this).clearRect (x, y, rectWidth, rectHeight);
+}
+
+void Window::setUseCanvas (bool shouldUseCanvas)
+{
+    Curses::Lock lock;
+    ++contentVersion;
+
+    if (! shouldUseCanvas)
+    {
+        canvas.reset();
+    }
+    else if (! canvas)
+    {
+        canvas.reset (new Canvas (width, height));
+    }
+}
+
+void Window::commit()
+{
+    DrawSession (*this).commit ();
+}
+
+int Window::getX() const
+{
+    return positionX;
+}
+
+int Window::getY() const
+{
+    return positionY;
+}
+
+int Window::getWidth() const
+{
+    return width;
+}
+
+int Window::getHeight() const
+{
+    return height;
+}
+
+bool Window::getVisibleBounds (int &left, int &top, int &right, int &bottom) const
+{
+    if (window->isHidden())
+    {
+        return false;
+    }
+
+    // Only used with the Curses lock held, so the scratch space can be shared.
+    static std::vector <CellRectangle> visible, remainder;
+
+    visible.assign (1, CellRectangle {std::max (positionX, 0), std::max (positionY, 0),
+                                      std::min (positionX + width, Curses::getInstance().getScreenWidth()),
+                                      std::min (positionY + height, Curses::getInstance().getScreenHeight())});
+
+    if (visible [0].left >= visible [0].right || visible [0].top >= visible [0].bottom)
+    {
+        return false;
+    }
+
+    for (const TerminalWindow *above = window->getWindowAbove(); above != nullptr && ! visible.empty();
+         above = above->getWindowAbove())
+    {
+        CellRectangle cover {above->getX(), above->getY(),
+                             above->getX() + above->getWidth(), above->getY() + above->getHeight()};
+        remainder.clear();
+
+        for (const auto &area : visible)
+        {
+            subtractRectangle (area, cover, remainder);
+        }
+
+        visible.swap (remainder);
+    }
+
+    if (visible.empty())
+    {
+        return false;
+    }
+
+    CellRectangle bounds = visible [0];
+
+    for (const auto &area : visible)
+    {
+        bounds.left = std::min (bounds.left, area.left);
+        bounds.top = std::min (bounds.top, area.top);
+        bounds.right = std::max (bounds.right, area.right);
+        bounds.bottom = std::max (bounds.bottom, area.bottom);
+    }
+
+    left = bounds.left - positionX;
+    top = bounds.top - positionY;
+    right = bounds.right - positionX;
+    bottom = bounds.bottom - positionY;
+
+    return true;
+}
+
+Window::VideoAttributes Window::getVideoAttributes() const
+{
+    Curses::Lock lock;
+    return VideoAttributes {attributes | COLOR_PAIR (colourPair), colourPair, backgroundColour, foregroundColour};
+}
+
+void Window::setVideoAttributes (const VideoAttributes &attributes)
+{
+    DrawSession (*this).setVideoAttributes (attributes);
+}
+
+Window::AttributeStatistics Window::getAttributeStatistics() const
+{
+    Curses::Lock lock;
+    return AttributeStatistics {attributeRequests, attributeLibraryCalls, attributeRequests - attributeLibraryCalls};
+}
+
+void Window::resetAttributeStatistics()
+{
+    Curses::Lock lock;
+    attributeRequests = 0;
+    attributeLibraryCalls = 0;
+}
+
+void Window::setBackgroundColour (Curses::Colour newBackgroundColour)
+{
+    DrawSession (*this).setBackgroundColour (newBackgroundColour);
+}
+
+void Window::setForegroundColour (Curses::Colour newForegroundColour)
+{
+    DrawSession (*this).setForegroundColour (newForegroundColour);
+}
+
+void Window::setColours (Curses::Colour newBackgroundColour, Curses::Colour newForegroundColour)
+{
+    DrawSession (*this).setColours (newBackgroundColour, newForegroundColour);
+}
+
+void Window::setBold (bool setting)
+{
+    DrawSession (*this).setBold (setting);
+}
+
+void Window::setUnderline (bool setting)
+{
+    DrawSession (*this).setUnderline (setting);
+}
+
+Window::DrawSession::DrawSession (Window &windowToDrawOn)
+    : target (windowToDrawOn),
+      previousView (target.view),
+      clipStackDepth (target.clipStack.size()),
+      nested (false)
+{
+    target.resetView();
+
+    // Other windows may have used up the colour pairs since this one last drew, and been
+    // given its pair.
+    target.refreshColourPair();
+}
+
+Window::DrawSession::DrawSession (DrawSession &parentSession, int x, int y, int viewWidth, int viewHeight)
+    : target (parentSession.target),
+      previousView (target.view),
+      clipStackDepth (target.clipStack.size()),
+      nested (true)
+{
+    ViewState &view = target.view;
+
+    view.originX = previousView.originX + x;
+    view.originY = previousView.originY + y;
+    view.width = std::max (viewWidth, 0);
+    view.height = std::max (viewHeight, 0);
+
+    view.clipLeft = std::max (previousView.clipLeft, view.originX);
+    view.clipTop = std::max (previousView.clipTop, view.originY);
+    view.clipRight = std::max (std::min (previousView.clipRight, view.originX + view.width), view.clipLeft);
+    view.clipBottom = std::max (std::min (previousView.clipBottom, view.originY + view.height), view.clipTop);
+
+    view.cursorX = view.originX;
+    view.cursorY = view.originY;
+    view.active = true;
+}
+
+Window::DrawSession::~DrawSession()
+{
+    target.clipStack.resize (clipStackDepth);
+
+    // The parent of a nested session gets its view back, clip region and all. Otherwise
+    // the window may have been resized since the session began, so a whole window view
+    // is rebuilt rather than restored.
+    if (nested)
+    {
+        target.view = previousView;
+    }
+    else
+    {
+        target.resetView();
+    }
+}
+
+void Window::DrawSession::restrictClip (int x, int y, int clipWidth, int clipHeight)
+{
+    ViewState &view = target.view;
+
+    view.clipLeft = std::max (view.clipLeft, view.originX + x);
+    view.clipTop = std::max (view.clipTop, view.originY + y);
+    view.clipRight = std::max (std::min (view.clipRight, view.originX + x + clipWidth), view.clipLeft);
+    view.clipBottom = std::max (std::min (view.clipBottom, view.originY + y + clipHeight), view.clipTop);
+}
+
+bool Window::DrawSession::isRegionVisible (int x, int y, int regionWidth, int regionHeight) const
+{
+    const ViewState &view = target.view;
+    int left = view.originX + x;
+    int top = view.originY + y;
+
+    return left < view.clipRight && left + regionWidth > view.clipLeft
+           && top < view.clipBottom && top + regionHeight > view.clipTop
+           && regionWidth > 0 && regionHeight > 0;
+}
+
+void Window::DrawSession::pushClip (int x, int y, int clipWidth, int clipHeight)
+{
+    const ViewState &view = target.view;
+    target.clipStack.push_back (ClipRegion {view.clipLeft, view.clipTop, view.clipRight, view.clipBottom});
+    restrictClip (x, y, clipWidth, clipHeight);
+}
+
+void Window::DrawSession::popClip()
+{
+    if (target.clipStack.size() <= clipStackDepth)
+    {
+        return;
+    }
+
+    const ClipRegion &region = target.clipStack.back();
+    ViewState &view = target.view;
+    view.clipLeft = region.left;
+    view.clipTop = region.top;
+    view.clipRight = region.right;
+    view.clipBottom = region.bottom;
+
+    target.clipStack.pop_back();
+}
+
+bool Window::DrawSession::isInsideClip (int x, int y) const
+{
+    const ViewState &view = target.view;
+    x += view.originX;
+    y += view.originY;
+
+    return x >= view.clipLeft && x < view.clipRight && y >= view.clipTop && y < view.clipBottom;
+}
+
+int Window::DrawSession::getWidth() const
+{
+    return target.view.width;
+}
+
+int Window::DrawSession::getHeight() const
+{
+    return target.view.height;
+}
+
+int Window::DrawSession::getTextWidth (const std::string &text) const
+{
+    return Curses::getInstance().displayTexts.getWidth (text);
+}
+
+Window::VideoAttributes Window::DrawSession::getVideoAttributes() const
+{
+    // The same as wattr_get, which includes the colour in the attributes.
+    ++target.attributeRequests;
+    return VideoAttributes {target.attributes | COLOR_PAIR (target.colourPair), target.colourPair,
+                            target.backgroundColour, target.foregroundColour};
+}
+
+void Window::DrawSession::printCharacter (const chtype character)
+{
+    target.emitCharacter (character);
+}
+
+void Window::DrawSession::printCharacter (const chtype character, int x, int y)
+{
+    target.emitCharacter (character, x, y);
+}
+
+void Window::DrawSession::printString (const std::string &string)
+{
+    target.emitText (string);
+}
+
+void Window::DrawSession::printString (const std::string &string, int x, int y)
+{
+    target.emitText (string, x, y);
+}
+
+void Window::DrawSession::printDouble (double value, const NumberFormat &format)
+{
+    char text [NumberFormat::bufferSize];
+    target.emitString (text, format.formatDouble (value, text));
+}
+
+void Window::DrawSession::printDouble (double value, int x, int y, const NumberFormat &format)
+{
+    char text [NumberFormat::bufferSize];
+    target.emitString (text, format.formatDouble (value, text), x, y);
+}
+
+void Window::DrawSession::printInteger (int value, const NumberFormat &format)
+{
+    char text [NumberFormat::bufferSize];
+    target.emitString (text, format.formatInteger (value, text));
+}
+
+void Window::DrawSession::printInteger (int value, int x, int y, const NumberFormat &format)
+{
+    char text [NumberFormat::bufferSize];
+    target.emitString (text, format.formatInteger (value, text), x, y);
+}
+
+void Window::DrawSession::drawLine (int startX, int startY, int endX, int endY, const chtype character)
+{
+    if (startY == endY)
+    {
+        target.drawHorizontalLine (std::min (startX, endX), std::max (startX, endX), startY, character);
+        return;
+    }
+
+    if (startX == endX)
+    {
+        target.drawVerticalLine (startX, std::min (startY, endY), std::max (startY, endY), character);
+        return;
+    }
+
+    const ViewState &view = target.view;
+    int clipLeft = view.clipLeft - view.originX;
+    int clipTop = view.clipTop - view.originY;
+    int clipRight = view.clipRight - view.originX;
+    int clipBottom = view.clipBottom - view.originY;
+
+    // A line whose bounding box misses the clip region cannot touch it.
+    if (std::max (startX, endX) < clipLeft || std::min (startX, endX) >= clipRight
+        || std::max (startY, endY) < clipTop || std::min (startY, endY) >= clipBottom)
+    {
+        return;
+    }
+
+    int xRange = endX - startX;
+    int yRange = endY - startY;
+
+    int x = startX;
+    int y = startY;
+
+    int *majorDimension = &x;
+    int *minorDimension = &y;
+    int majorRange = xRange;
+    int minorRange = yRange;
+    int majorClipStart = clipLeft, majorClipEnd = clipRight;
+    int minorClipStart = clipTop, minorClipEnd = clipBottom;
+
+    if (abs (xRange) < abs (yRange))
+    {
+        std::swap (majorDimension, minorDimension);
+        std::swap (majorRange, minorRange);
+        std::swap (majorClipStart, minorClipStart);
+        std::swap (majorClipEnd, minorClipEnd);
+    }
+
+    int majorIncrement = MathsTools::sign (majorRange);
+    int minorIncrement = MathsTools::sign (minorRange);
+    int majorLength = abs (majorRange);
+    int minorLength = abs (minorRange);
+    int majorStart = *majorDimension;
+    int minorStart = *minorDimension;
+
+    // Work out the steps for which the line can be inside the clip region, in the manner of
+    // Liang-Barsky, so the walk starts at the first visible cell and stops after the last.
+    // Along the major axis the bounds are exact. Along the minor axis they come from the
+    // ideal line, widened by a step each way to cover the rounding.
+    int firstStep, lastStep;
+
+    if (majorIncrement > 0)
+    {
+        firstStep = majorClipStart - majorStart;
+        lastStep = majorClipEnd - 1 - majorStart;
+    }
+    else
+    {
+        firstStep = majorStart - (majorClipEnd - 1);
+        lastStep = majorStart - majorClipStart;
+    }
+
+    int firstOffset = minorIncrement > 0 ? minorClipStart - minorStart : minorStart - (minorClipEnd - 1);
+    int lastOffset = minorIncrement > 0 ? minorClipEnd - 1 - minorStart : minorStart - minorClipStart;
+    long long doubleMajorLength = 2LL * majorLength;
+
+    if (firstOffset > 0)
+    {
+        firstStep = std::max (firstStep, static_cast <int> ((2LL * firstOffset - 1) * majorLength / (2LL * minorLength)) - 1);
+    }
+
+    lastStep = std::min (lastStep, static_cast <int> ((2LL * lastOffset + 1) * majorLength / (2LL * minorLength)) + 1);
+    firstStep = std::max (firstStep, 0);
+    lastStep = std::min (lastStep, majorLength);
+
+    if (firstStep > lastStep)
+    {
+        return;
+    }
+
+    // The error term is twice the distance from the plotted minor position to the ideal one,
+    // measured in the direction of minorIncrement and scaled by majorLength. Exact halves are
+    // rounded away from zero, matching round() on the ideal position.
+    long long scaledMinor = 2LL * firstStep * minorLength;
+    int minorOffset = static_cast <int> (scaledMinor / doubleMajorLength);
+    long long remainder = scaledMinor - minorOffset * doubleMajorLength;
+    int tiePosition = minorStart + minorIncrement * minorOffset;
+
+    if (remainder > majorLength
+        || (remainder == majorLength && (minorIncrement > 0 ? tiePosition >= 0 : tiePosition <= 0)))
+    {
+        ++minorOffset;
+    }
+
+    *majorDimension = majorStart + majorIncrement * firstStep;
+    *minorDimension = minorStart + minorIncrement * minorOffset;
+    int error = static_cast <int> (scaledMinor - minorOffset * doubleMajorLength);
+
+    for (int step = firstStep; step <= lastStep; ++step)
+    {
+        if (isInsideClip (x, y))
+        {
+            target.emitCharacter (character, x, y);
+        }
+
+        *majorDimension += majorIncrement;
+        error += 2 * minorLength;
+
+        bool halfwayAwayFromZero = minorIncrement > 0 ? *minorDimension >= 0 : *minorDimension <= 0;
+
+        if (error > majorLength || (error == majorLength && halfwayAwayFromZero))
+        {
+            *minorDimension += minorIncrement;
+            error -= 2 * majorLength;
+        }
+    }
+}
+
+void Window::DrawSession::drawEllipse (int x, int y, int width, int height, const chtype character)
+{
+    target.rasteriseEllipse (x, y, width, height, character, false);
+}
+
+void Window::DrawSession::fillEllipse (int x, int y, int width, int height, const chtype character)
+{
+    target.rasteriseEllipse (x, y, width, height, character, true);
+}
+
+void Window::DrawSession::drawBox (int x, int y, int width, int height)
+{
+    int rightX = x + width - 1;
+    int bottomY = y + height - 1;
+
+    // Boxes less than two cells across still draw their corners and sides, which can then
+    // reach past the other edge, so the bounds take in everything the lines can touch.
+    int boundsLeft = std::min (x, rightX - 1);
+    int boundsTop = std::min (y, bottomY - 1);
+    int boundsRight = std::max (rightX, x + 1);
+    int boundsBottom = std::max (bottomY, y + 1);
+
+    if (! isRegionVisible (boundsLeft, boundsTop, boundsRight - boundsLeft + 1, boundsBottom - boundsTop + 1))
+    {
+        return;
+    }
+    printCharacter (ACS_ULCORNER, x, y);
+    printCharacter (ACS_LLCORNER, x, bottomY);
+    printCharacter (ACS_URCORNER, rightX, y);
+    printCharacter (ACS_LRCORNER, rightX, bottomY);
+
+    int horizontalStart = x + 1;
+    int horizontalEnd = rightX - 1;
+    drawLine (horizontalStart, y, horizontalEnd, y, ACS_HLINE);
+    drawLine (horizontalStart, bottomY, horizontalEnd, bottomY, ACS_HLINE);
+
+    int verticalStart = y + 1;
+    int verticalEnd = bottomY - 1;
+    drawLine (x, verticalStart, x, verticalEnd, ACS_VLINE);
+    drawLine (rightX, verticalStart, rightX, verticalEnd, ACS_VLINE);
+}
+
+void Window::DrawSession::fillRect (int x, int y, int rectWidth, int rectHeight, const chtype character)
+{
+    const ViewState &view = target.view;
+    int left = std::max (x, view.clipLeft - view.originX);
+    int right = std::min (x + rectWidth, view.clipRight - view.originX);
+    int top = std::max (y, view.clipTop - view.originY);
+    int bottom = std::min (y + rectHeight, view.clipBottom - view.originY);
+
+    if (left >= right || top >= bottom)
+    {
+        return;
+    }
+
+    ++target.contentVersion;
+
+    // waddchnstr copies cells verbatim, so the window attributes are merged in here the
+    // same way waddch would do it.
+    int spanLength = right - left;
+    target.spanBuffer.assign (spanLength, target.renderCharacter (character));
+
+    for (int row = top; row < bottom; ++row)
+    {
+        target.emitCells (target.spanBuffer.data(), spanLength, left, row);
+    }
+}
+
+void Window::DrawSession::fillAll (const chtype character)
+{
+    fillRect (0, 0, target.view.width, target.view.height, character);
+}
+
+void Window::DrawSession::clear()
+{
+    ViewState &view = target.view;
+
+    // Part of a window is cleared to plain blanks, as the whole of a canvas would be.
+    ++target.contentVersion;
+
+    if (view.active || target.isClipRestricted())
+    {
+        clearRect (0, 0, view.width, view.height);
+
+        if (view.active)
+        {
+            view.cursorX = view.originX;
+            view.cursorY = view.originY;
+        }
+        else
+        {
+            target.placeCursor (0, 0);
+        }
+    }
+    else if (target.canvas)
+    {
+        target.canvas->clear();
+    }
+    else
+    {
+        target.window->erase();
+    }
+}
+
+void Window::DrawSession::clearRect (int x, int y, int rectWidth, int rectHeight)
+{
+    const ViewState &view = target.view;
+    int left = std::max (x, view.clipLeft - view.originX);
+    int right = std::min (x + rectWidth, view.clipRight - view.originX);
+    int top = std::max (y, view.clipTop - view.originY);
+    int bottom = std::min (y + rectHeight, view.clipBottom - view.originY);
+
+    if (left >= right || top >= bottom)
+    {
+        return;
+    }
+
+    int spanLength = right - left;
+    target.spanBuffer.assign (spanLength, ' ');
+
+    for (int row = top; row < bottom; ++row)
+    {
+        target.emitCells (target.spanBuffer.data(), spanLength, left, row);
+    }
+}
+
+void Window::DrawSession::commit()
+{
+    if (target.canvas && ! target.view.active)
+    {
+        target.canvas->commit (*target.window);
+    }
+}
+
+void Window::DrawSession::setVideoAttributes (const VideoAttributes &attributes)
+{
+    // The pair may have been given to other colours since the attributes were read, so
+    // the colours are looked up again rather than trusting the pair.
+    target.backgroundColour = attributes.backgroundColour;
+    target.foregroundColour = attributes.foregroundColour;
+    target.requestAttributes (attributes.attributes & ~A_COLOR, target.lookUpColourPair());
+}
+
+void Window::DrawSession::setBackgroundColour (Curses::Colour newBackgroundColour)
+{
+    setColours (newBackgroundColour, target.foregroundColour);
+}
+
+void Window::DrawSession::setForegroundColour (Curses::Colour newForegroundColour)
+{
+    setColours (target.backgroundColour, newForegroundColour);
+}
+
+void Window::DrawSession::setColours (Curses::Colour newBackgroundColour, Curses::Colour newForegroundColour)
+{
+    target.backgroundColour = newBackgroundColour;
+    target.foregroundColour = newForegroundColour;
+
+    target.requestAttributes (target.attributes, target.lookUpColourPair());
+}
+
+void Window::DrawSession::setBold (bool setting)
+{
+    target.requestAttributes (setting ? target.attributes | A_BOLD : target.attributes & ~A_BOLD,
+                              target.colourPair);
+}
+
+void Window::DrawSession::setUnderline (bool setting)
+{
+    target.requestAttributes (setting ? target.attributes | A_UNDERLINE : target.attributes & ~A_UNDERLINE,
+                              target.colourPair);
+}
+
+bool NumberField::Placement::operator== (const Placement &other) const
+{
+    return window == other.window && contentVersion == other.contentVersion
+           && x == other.x && y == other.y
+           && clipLeft == other.clipLeft && clipTop == other.clipTop
+           && clipRight == other.clipRight && clipBottom == other.clipBottom
+           && attributes == other.attributes && colourPair == other.colourPair
+           && usesCanvas == other.usesCanvas;
+}
+
+NumberField::NumberField (int xInit, int yInit, const NumberFormat &formatInit)
+    : x (xInit), y (yInit),
+      format (formatInit)
+{
+    invalidate();
+}
+
+bool NumberField::printDouble (Window::DrawSession &session, double value)
+{
+    char text [NumberFormat::bufferSize];
+    return print (session, text, format.formatDouble (value, text));
+}
+
+bool NumberField::printInteger (Window::DrawSession &session, int value)
+{
+    char text [NumberFormat::bufferSize];
+    return print (session, text, format.formatInteger (value, text));
+}
+
+void NumberField::setPosition (int newX, int newY)
+{
+    x = newX;
+    y = newY;
+    invalidate();
+}
+
+void NumberField::setFormat (const NumberFormat &newFormat)
+{
+    format = newFormat;
+    invalidate();
+}
+
+void NumberField::invalidate()
+{
+    printedPlacement = Placement {nullptr, 0, 0, 0, 0, 0, 0, 0, A_NORMAL, 0, false};
+    printedText.clear();
+}
+
+int NumberField::getLength() const
+{
+    return static_cast <int> (printedText.size());
+}
+
+bool NumberField::isShownOn (const Window &window, const Placement &placement) const
+{
+    if (! window.canvas || placement.y < placement.clipTop || placement.y >= placement.clipBottom)
+    {
+        return true;
+    }
+
+    int start = std::max (placement.x, placement.clipLeft);
+    int end = std::min (placement.x + static_cast <int> (printedText.size()), placement.clipRight);
+
+    for (int cellX = start; cellX < end; ++cellX)
+    {
+        chtype character = static_cast <unsigned char> (printedText [cellX - placement.x]);
+
+        if (! window.canvas->hasCell (window.renderCharacter (character), cellX, placement.y))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool NumberField::print (Window::DrawSession &session, const char *text, int length)
+{
+    Window &window = session.target;
+    const Window::DrawSession::ViewState &view = window.view;
+
+    // A canvas can say what its cells hold, so there the cells are checked instead of
+    // relying on the window not having been cleared since the field was printed.
+    Placement placement {&window, window.canvas ? 0 : window.contentVersion,
+                         view.originX + x, view.originY + y,
+                         view.clipLeft, view.clipTop, view.clipRight, view.clipBottom,
+                         window.attributes, window.colourPair, window.canvas != nullptr};
+
+    // A field which reaches the end of a row moves the cursor on to the next row, so only
+    // fields which end within their row can be skipped without upsetting the cursor.
+    bool endsWithinRow = placement.x >= 0 && placement.x + length < window.width;
+
+    if (endsWithinRow && placement == printedPlacement
+        && printedText.compare (0, std::string::npos, text, length) == 0
+        && isShownOn (window, placement))
+    {
+        int endX = placement.x + length;
+
+        if (view.active)
+        {
+            window.view.cursorX = endX;
+            window.view.cursorY = placement.y;
+        }
+        else if (window.canvas)
+        {
+            window.canvas->moveCursor (endX, placement.y);
+        }
+        else
+        {
+            window.window->moveCursor (endX, placement.y);
+        }
+
+        return false;
+    }
+
+    window.emitString (text, length, x, y);
+
+    printedPlacement = placement;
+    printedText.assign (text, length);
+    return true;
 }
@@ -4,17 +4,24 @@
 #include <memory>
 #include <string>
 #include <mutex>
+#include <vector>
 #include <curses.h>
-#include <panel.h>
+#include "Canvas.hpp"
+#include "ColourPairCache.hpp"
+#include "DisplayTextCache.hpp"
+#include "NumberFormat.hpp"
+#include "TerminalBackend.hpp"
 
 class Window;
 
-/** A singleton class which manages the lifetime of the ncurses library. */
+/** A singleton class which manages the lifetime of the ncurses library.
+ *
+ *  Everything is drawn through a TerminalBackend, which is an NcursesBackend unless
+ *  another backend is set before the instance is first used.
+ */
 class Curses
 {
 public:
-    using WindowPointer = std::unique_ptr <WINDOW, int(*)(WINDOW*)>;
-    using PanelPointer = std::unique_ptr <PANEL, int(*)(PANEL*)>;
     using Instance = Curses&;
 
     /** Destructor */
@@ -23,6 +30,17 @@ public:
     /** Get the singleton instance of the ncurses library. */
     static Instance getInstance();
 
+    /** Set the backend to use instead of ncurses, such as a MemoryBackend.
+     *
+     *  This only has an effect before getInstance() is first called. Returns false if it
+     *  is too late.
+     *
+     *  @param newBackend the backend to use
+     */
+    static bool setBackend (std::unique_ptr <TerminalBackend> newBackend);
+    /** Returns the backend everything is drawn through. */
+    TerminalBackend& getBackend();
+
     /** Create a new window. 
      *
      *  @param x the x position of the new window
@@ -37,7 +55,17 @@ public:
     /** Returns the height of the terminal in characters. */
     int getScreenHeight() const;
 
-    /** An enum type for the standard ncurses colours. */
+    /** Ask the terminal for its size and resize the ncurses screen to match.
+     *
+     *  Call this after the terminal has been resized. Returns true if the size changed.
+     */
+    bool updateScreenSize();
+
+    /** An enum type for the standard ncurses colours.
+     *
+     *  On terminals with more colours, any colour number below getNumColours() can be
+     *  cast to a Colour.
+     */
     enum class Colour : short
     {
         black = COLOR_BLACK, /**< Black */
@@ -52,16 +80,34 @@ public:
 
     using ColourPair = short;
 
+    /** Returns the number of colours the terminal can show. */
+    int getNumColours() const;
+
     /** Return the index for a given pair of colours.
      *
-     *  When the Curses singleton is first instantiated every possible pair of colours is
-     *  initialised to a given index. This function returns the index a particular pair
-     *  was initialised to.
+     *  Pairs are initialised the first time they are asked for, and once the terminal's
+     *  pairs have all been used the least recently used pair is reused.
+     *
+     *  @see ColourPairCache
      *
      *  @param backgroundColour the background colour of the pair
      *  @param foregroundColour the foreground colour of the pair
      */
     ColourPair getColourPairIndex (Colour backgroundColour, Colour foregroundColour);
+    /** Returns counts of colour pair lookups, allocations and reuses. */
+    ColourPairCache::Statistics getColourPairStatistics() const;
+
+    /** Returns the number of columns a UTF-8 string takes on screen.
+     *
+     *  Strings outside ASCII are measured once and remembered.
+     *
+     *  @see DisplayTextCache
+     *
+     *  @param text the string to measure
+     */
+    int getTextWidth (const std::string &text);
+    /** Returns counts of lookups in the cache of measured strings. */
+    DisplayTextCache::Statistics getDisplayTextStatistics() const;
 
     /** An enum type for cursor types. */
     enum class Cursor : int
@@ -79,6 +125,16 @@ public:
 
     /** Refresh the screens contents. */
     void refreshScreen();
+    /** Returns the next key pressed, or ERR if there is none waiting. Never waits. */
+    int readKey();
+
+    /** Returns a number which changes whenever a window is moved, resized, shown, hidden or
+     *  destroyed, or the screen is resized.
+     *
+     *  Comparing this with an earlier value tells whether any window may have been covered
+     *  or uncovered in between.
+     */
+    unsigned long getPanelStackVersion() const;
 
     /** A class to protect calls to ncurses functions. */
     class Lock
@@ -100,7 +156,13 @@ private:
     Curses& operator= (const Curses&) = delete;
     Curses& operator= (Curses&&) = delete;
 
-    std::recursive_mutex protectionMutex;
+    mutable std::recursive_mutex protectionMutex;
+    unsigned long panelStackVersion;
+    std::unique_ptr <TerminalBackend> backend;
+    std::unique_ptr <ColourPairCache> colourPairs;
+    DisplayTextCache displayTexts;
+
+    friend class Window;
 };
 
 /** An ncurses panel. */
@@ -124,14 +186,18 @@ public:
      *  @param y the new y position
      */
     void move (int x, int y);
-    /** Resize the window.
+    /** Move and resize the window.
+     *
+     *  The existing ncurses window is resized and moved in place. Returns true if the
+     *  window's bounds changed, or if ncurses had changed the window itself, for example
+     *  when the terminal shrank.
      *
      *  @param x the new x position
      *  @param y the new y position
      *  @param newWidth the new width
      *  @param newHeight the new height
      */
-    void resize (int x, int y, int newWidth, int newHeight);
+    bool resize (int x, int y, int newWidth, int newHeight);
 
     /** Print a character at the current cursor position.
      *
@@ -147,11 +213,17 @@ public:
     void printCharacter (const chtype character, int x, int y);
 
     /** Print a string at the current cursor position.
+     *
+     *  The string is UTF-8. ASCII strings are written a byte per column. Other strings are
+     *  written as wide characters, and are cut off at the edge of the window instead of
+     *  wrapping.
      *
      *  @param string the string to print
      */
     void printString (const std::string &string);
     /** Print a string at the given position.
+     *
+     *  @see printString
      *
      *  @param string the string to print
      *  @param x the x position of the string
@@ -160,30 +232,36 @@ public:
     void printString (const std::string &string, int x, int y);
 
     /** Print a floating point number at the current cursor position.
+     *
+     *  The number is formatted on the stack and written in one go.
      *
      *  @param value the value to print
+     *  @param format how to lay the number out, by default with two decimal places
      */
-    void printDouble (double value);
+    void printDouble (double value, const NumberFormat &format = NumberFormat());
     /** Print a floating point number at the given position.
      *
      *  @param value the value to print
      *  @param x the x position of the value
      *  @param y the y position of the value
+     *  @param format how to lay the number out, by default with two decimal places
      */
-    void printDouble (double value, int x, int y);
+    void printDouble (double value, int x, int y, const NumberFormat &format = NumberFormat());
 
     /** Print an integer at the current cursor position.
      *
      *  @param value the value to print
+     *  @param format how to lay the number out
      */
-    void printInteger (int value);
+    void printInteger (int value, const NumberFormat &format = NumberFormat());
     /** Print an integer at the given position.
      *
      *  @param value the value to print
      *  @param x the x position of the value
      *  @param y the y position of the value
+     *  @param format how to lay the number out
      */
-    void printInteger (int value, int x, int y);
+    void printInteger (int value, int x, int y, const NumberFormat &format = NumberFormat());
 
     /** Draw a straight line.
      *
@@ -203,6 +281,15 @@ public:
      *  @param character the character to use for printing the ellipse
      */
     void drawEllipse (int x, int y, int width, int height, const chtype character = '.');
+    /** Draw a filled ellipse.
+     *
+     *  @param x the x position
+     *  @param y the y position
+     *  @param width the width of the ellipse
+     *  @param height the height of the ellipse
+     *  @param character the character to use for filling the ellipse
+     */
+    void fillEllipse (int x, int y, int width, int height, const chtype character = '.');
 
     /** Draw a box.
      *
@@ -213,24 +300,80 @@ public:
      */
     void drawBox (int x, int y, int width, int height);
 
+    /** Fill a rectangle with a character.
+     *
+     *  The rectangle is clipped to the window and written a row at a time.
+     *
+     *  @param x the x position
+     *  @param y the y position
+     *  @param rectWidth the width of the rectangle
+     *  @param rectHeight the height of the rectangle
+     *  @param character the character to print
+     */
+    void fillRect (int x, int y, int rectWidth, int rectHeight, const chtype character);
     /** Fill the entire window with a character.
      *  
      *  @param character the character to print
      */
-    void fillAll(const chtype character);
+    void fillAll (const chtype character);
     /** Clear the window. */
     void clear();
+    /** Clear a rectangle to plain blanks, with no attributes or colour.
+     *
+     *  Unlike clear(), this is ordinary drawing as far as number fields are concerned, so
+     *  a component can clear around its fields without making them print again.
+     *
+     *  @param x the x position
+     *  @param y the y position
+     *  @param rectWidth the width of the rectangle
+     *  @param rectHeight the height of the rectangle
+     */
+    void clearRect (int x, int y, int rectWidth, int rectHeight);
+
+    /** Set whether drawing goes into an off-screen canvas.
+     *
+     *  While a canvas is in use, drawing only reaches the window when commit() is called,
+     *  and then only the cells which have changed are written.
+     *
+     *  @param shouldUseCanvas whether to use a canvas
+     */
+    void setUseCanvas (bool shouldUseCanvas);
+    /** Write the changed cells of the canvas to the window.
+     *
+     *  Does nothing if the window is not using a canvas.
+     */
+    void commit();
 
+    /** Returns the windows x position. */
+    int getX() const;
+    /** Returns the windows y position. */
+    int getY() const;
     /** Returns the windows width. */
     int getWidth() const;
     /** Returns the windows height. */
     int getHeight() const;
 
+    /** Find the part of the window which can be seen on the screen.
+     *
+     *  The windows of the panels above this one are taken away from the window's area, as
+     *  is anything off the screen. Returns false if nothing is left, otherwise sets the
+     *  bounds, in window coordinates, of the smallest rectangle holding everything left.
+     *  The caller must hold a Curses::Lock.
+     *
+     *  @param left set to the left edge of the visible part
+     *  @param top set to the top edge of the visible part
+     *  @param right set to one past the right edge of the visible part
+     *  @param bottom set to one past the bottom edge of the visible part
+     */
+    bool getVisibleBounds (int &left, int &top, int &right, int &bottom) const;
+
     /** A structure which holds ncurses video attributes. */
     struct VideoAttributes
     {
         attr_t attributes; /**< The attributes. */
         short colourPair; /**< The colour pair. */
+        Curses::Colour backgroundColour; /**< The background colour of the pair. */
+        Curses::Colour foregroundColour; /**< The foreground colour of the pair. */
     };
 
     /** Returns the currently set video attributes for this window. */
@@ -238,6 +381,8 @@ public:
     /** Sets the video attributes for this window. 
      *
      *  The new attributes will be applied to any drawing done on the window after this call.
+     *  The colour pair is looked up again from the colours, as the pair may have been given
+     *  other colours since the attributes were read.
      *
      *  @param attributes the new attributes to set.
      */
@@ -274,19 +419,406 @@ public:
      */
     void setUnderline (bool setting);
 
+    /** Counts of how often the window's attributes were set and passed on to ncurses.
+     *
+     *  Attributes are kept in the window and only passed to ncurses when something is drawn
+     *  straight to the window with them, so most requests need no library call at all.
+     */
+    struct AttributeStatistics
+    {
+        long requests; /**< The number of times attributes or colours were read or set. */
+        long libraryCalls; /**< The number of calls made to ncurses to apply them. */
+        long libraryCallsAvoided; /**< The number of requests which needed no library call. */
+    };
+
+    /** Returns counts of attribute requests and the library calls they needed. */
+    AttributeStatistics getAttributeStatistics() const;
+    /** Set the attribute counts back to zero. */
+    void resetAttributeStatistics();
+
+    /** A batch of drawing operations on a window.
+     *
+     *  A session takes the Curses lock when it is created and holds it until it is
+     *  destroyed, so its drawing functions do not need to take the lock themselves. Each of
+     *  the drawing functions on Window is equivalent to a session which lasts for a single
+     *  operation, so drawing a lot through one session is much cheaper than calling Window
+     *  repeatedly.
+     *
+     *  The functions behave exactly like the Window functions of the same name.
+     *
+     *  A session can also be made for a rectangle within another session. All of its
+     *  coordinates are relative to the rectangle, its width and height are those of the
+     *  rectangle, and nothing it draws reaches outside the rectangle or the parent
+     *  session's clip region. Strings are cut off at the edge of the clip region instead
+     *  of wrapping. This lets several components share one window.
+     */
+    class DrawSession
+    {
+    public:
+        /** Constructor
+         *
+         *  @param windowToDrawOn the window to draw on
+         */
+        explicit DrawSession (Window &windowToDrawOn);
+        /** Constructor for a session which draws into a rectangle of another session.
+         *
+         *  The parent session must outlive this one, and must not be drawn on while this
+         *  one exists.
+         *
+         *  @param parentSession the session to draw into
+         *  @param x the x position of the rectangle in the parent session
+         *  @param y the y position of the rectangle in the parent session
+         *  @param viewWidth the width of the rectangle
+         *  @param viewHeight the height of the rectangle
+         */
+        DrawSession (DrawSession &parentSession, int x, int y, int viewWidth, int viewHeight);
+        /** Destructor */
+        ~DrawSession();
+
+        /** @see Window::printCharacter */
+        void printCharacter (const chtype character);
+        /** @see Window::printCharacter */
+        void printCharacter (const chtype character, int x, int y);
+        /** @see Window::printString */
+        void printString (const std::string &string);
+        /** @see Window::printString */
+        void printString (const std::string &string, int x, int y);
+        /** @see Window::printDouble */
+        void printDouble (double value, const NumberFormat &format = NumberFormat());
+        /** @see Window::printDouble */
+        void printDouble (double value, int x, int y, const NumberFormat &format = NumberFormat());
+        /** @see Window::printInteger */
+        void printInteger (int value, const NumberFormat &format = NumberFormat());
+        /** @see Window::printInteger */
+        void printInteger (int value, int x, int y, const NumberFormat &format = NumberFormat());
+
+        /** @see Window::drawLine */
+        void drawLine (int startX, int startY, int endX, int endY, const chtype character = ACS_BLOCK);
+        /** @see Window::drawEllipse */
+        void drawEllipse (int x, int y, int width, int height, const chtype character = '.');
+        /** @see Window::fillEllipse */
+        void fillEllipse (int x, int y, int width, int height, const chtype character = '.');
+        /** @see Window::drawBox */
+        void drawBox (int x, int y, int width, int height);
+        /** @see Window::fillRect */
+        void fillRect (int x, int y, int rectWidth, int rectHeight, const chtype character);
+        /** @see Window::fillAll */
+        void fillAll (const chtype character);
+        /** @see Window::clear */
+        void clear();
+        /** @see Window::clearRect */
+        void clearRect (int x, int y, int rectWidth, int rectHeight);
+        /** @see Window::commit
+         *
+         *  Does nothing in a session for a rectangle of another session, as the window is
+         *  committed by the outermost session.
+         */
+        void commit();
+
+        /** @see Window::getWidth */
+        int getWidth() const;
+        /** @see Window::getHeight */
+        int getHeight() const;
+        /** @see Curses::getTextWidth */
+        int getTextWidth (const std::string &text) const;
+
+        /** Limit drawing to a rectangle for the rest of the session.
+         *
+         *  The rectangle is intersected with the current clip region, so this can only
+         *  ever shrink it.
+         *
+         *  @param x the x position of the rectangle
+         *  @param y the y position of the rectangle
+         *  @param clipWidth the width of the rectangle
+         *  @param clipHeight the height of the rectangle
+         */
+        void restrictClip (int x, int y, int clipWidth, int clipHeight);
+        /** Returns true if any part of a rectangle lies within the clip region.
+         *
+         *  @param x the x position of the rectangle
+         *  @param y the y position of the rectangle
+         *  @param regionWidth the width of the rectangle
+         *  @param regionHeight the height of the rectangle
+         */
+        bool isRegionVisible (int x, int y, int regionWidth, int regionHeight) const;
+        /** Save the clip region and limit drawing to a rectangle within it.
+         *
+         *  The saved regions are kept on a stack in the window, so pushes and pops can be
+         *  nested. Anything still pushed when the session ends is popped.
+         *
+         *  @param x the x position of the rectangle
+         *  @param y the y position of the rectangle
+         *  @param clipWidth the width of the rectangle
+         *  @param clipHeight the height of the rectangle
+         */
+        void pushClip (int x, int y, int clipWidth, int clipHeight);
+        /** Restore the clip region saved by the last call to pushClip().
+         *
+         *  Does nothing if this session has nothing pushed.
+         */
+        void popClip();
+
+        /** @see Window::getVideoAttributes */
+        VideoAttributes getVideoAttributes() const;
+        /** @see Window::setVideoAttributes */
+        void setVideoAttributes (const VideoAttributes &attributes);
+        /** @see Window::setBackgroundColour */
+        void setBackgroundColour (Curses::Colour newBackgroundColour);
+        /** @see Window::setForegroundColour */
+        void setForegroundColour (Curses::Colour newForegroundColour);
+        /** @see Window::setColours */
+        void setColours (Curses::Colour newBackgroundColour, Curses::Colour newForegroundColour);
+        /** @see Window::setBold */
+        void setBold (bool setting);
+        /** @see Window::setUnderline */
+        void setUnderline (bool setting);
+
+    private:
+        DrawSession (const DrawSession&) = delete;
+        DrawSession& operator= (const DrawSession&) = delete;
+
+        Window &target;
+        Curses::Lock lock;
+
+        struct ViewState
+        {
+            int originX, originY;
+            int width, height;
+            int clipLeft, clipTop, clipRight, clipBottom;
+            int cursorX, cursorY;
+            bool active;
+        };
+
+        struct ClipRegion
+        {
+            int left, top, right, bottom;
+        };
+
+        ViewState previousView;
+        std::size_t clipStackDepth;
+        const bool nested;
+
+        bool isInsideClip (int x, int y) const;
+
+        friend class Window;
+        friend class NumberField;
+    };
+
 private:
     Window (int x, int y, int widthInit, int heightInit);
     Window (Window &other) = delete;
     Window& operator= (Window &rhs) = delete;
 
+    /** Draw a horizontal run of characters in one bulk call, clipped to the window.
+     *  The caller must hold a Curses::Lock.
+     */
+    void drawHorizontalLine (int startX, int endX, int y, const chtype character);
+    /** Draw a vertical run of characters in one bulk call, clipped to the window.
+     *  The caller must hold a Curses::Lock.
+     */
+    void drawVerticalLine (int x, int startY, int endY, const chtype character);
+    /** Walk the cells of an ellipse, either plotting its outline or filling it with
+     *  horizontal runs. Only the rows which can reach the clip region are walked.
+     */
+    void rasteriseEllipse (int x, int y, int width, int height, const chtype character, bool filled);
+    /** Write a character at the cursor, in view coordinates and clipped to the view.
+     *  The caller must hold a Curses::Lock.
+     */
+    void emitCharacter (const chtype character);
+    /** Write a character at a position to the canvas or the window.
+     *  The caller must hold a Curses::Lock.
+     */
+    void emitCharacter (const chtype character, int x, int y);
+    /** Write a string at the cursor to the canvas or the window.
+     *  The caller must hold a Curses::Lock.
+     */
+    void emitString (const char *string, int length);
+    /** Write a string at a position to the canvas or the window.
+     *  The caller must hold a Curses::Lock.
+     */
+    void emitString (const char *string, int length, int x, int y);
+    /** Write a row of already rendered characters to the canvas or the window.
+     *  The caller must hold a Curses::Lock.
+     */
+    void emitCells (const chtype *characters, int length, int x, int y);
+    /** Write a string at a position in view coordinates, cut off at the clip region.
+     *  The caller must hold a Curses::Lock.
+     */
+    void emitClippedString (const char *string, int length, int x, int y);
+    /** Write a UTF-8 string at the cursor, taking the ASCII path if it can.
+     *  The caller must hold a Curses::Lock.
+     */
+    void emitText (const std::string &text);
+    /** Write a UTF-8 string at a position, taking the ASCII path if it can.
+     *  The caller must hold a Curses::Lock.
+     */
+    void emitText (const std::string &text, int x, int y);
+    /** Write decoded text at a position in window coordinates, cut off at the clip region.
+     *  The caller must hold a Curses::Lock.
+     */
+    void emitDisplayText (const DisplayText &text, int x, int y);
+    /** Write a character at the cursor, in window coordinates, leaving it out if it falls
+     *  outside the clip region. The caller must hold a Curses::Lock.
+     */
+    void emitWrappedCharacter (const chtype character);
+    /** Write a string at a position in window coordinates, wrapping at the end of each row
+     *  as ncurses would, but leaving out whatever falls outside the clip region.
+     *  The caller must hold a Curses::Lock.
+     */
+    void emitWrappedString (const char *string, int length, int x, int y);
+    /** Returns true if the clip region leaves out part of the window. */
+    bool isClipRestricted() const;
+    /** Get the cursor position in window coordinates, outside a session for part of the
+     *  window. Returns false if the cursor is invalid.
+     */
+    bool getCursorPosition (int &x, int &y) const;
+    /** Move the cursor in window coordinates, outside a session for part of the window. */
+    void placeCursor (int x, int y);
+
+    /** Write a character at the cursor, in window coordinates, with no clipping. */
+    void putCharacter (const chtype character);
+    /** Write a character at a position, in window coordinates, with no clipping. */
+    void putCharacter (const chtype character, int x, int y);
+    /** Write a string at the cursor, in window coordinates, with no clipping. */
+    void putString (const char *string, int length);
+    /** Write a string at a position, in window coordinates, with no clipping. */
+    void putString (const char *string, int length, int x, int y);
+
+    /** Make the view cover the whole window. */
+    void resetView();
+    /** Merge the window's current attributes into a character, as waddch would. */
+    chtype renderCharacter (const chtype character) const;
+    /** Record new attributes, to be passed to ncurses when they are next needed. */
+    void requestAttributes (attr_t newAttributes, short newColourPair);
+    /** Returns the colour pair for the window's colours, noting which pairs the colour
+     *  cache had given out at the time. The caller must hold a Curses::Lock.
+     */
+    short lookUpColourPair();
+    /** Look the window's colour pair up again if the colour cache has given pairs new
+     *  colours since it was last looked up, as its pair may now hold other colours.
+     *  The caller must hold a Curses::Lock.
+     */
+    void refreshColourPair();
+    /** Pass the current attributes to ncurses if they differ from those it has.
+     *  The caller must hold a Curses::Lock.
+     */
+    void applyAttributes();
+
+    int positionX, positionY;
     int width, height;
 
-    Curses::WindowPointer window;
-    Curses::PanelPointer panel;
+    /** The part of the window drawing currently goes to, in window coordinates. Outside
+     *  a session for part of the window this is the whole window.
+     */
+    DrawSession::ViewState view;
+
+    std::unique_ptr <TerminalWindow> window;
 
     Curses::Colour backgroundColour, foregroundColour;
 
+    /** The attributes, without a colour, and the colour pair drawing uses. */
+    attr_t attributes;
+    short colourPair;
+    /** The colour cache's generation when colourPair was looked up. */
+    unsigned long colourPairGeneration;
+    /** The attributes and colour pair ncurses last had for the window. */
+    attr_t appliedAttributes;
+    short appliedColourPair;
+    long attributeRequests, attributeLibraryCalls;
+
+    std::vector <chtype> spanBuffer;
+    std::vector <cchar_t> wideBuffer;
+    std::unique_ptr <Canvas> canvas;
+
+    std::vector <DrawSession::ClipRegion> clipStack;
+
+    /** Changed whenever the window's contents may have been wiped, so number fields know
+     *  to print again.
+     */
+    unsigned long contentVersion;
+
     friend class Curses;
+    friend class NumberField;
+};
+
+/** A number shown at a fixed place in a window, which is only written out again when its
+ *  text changes.
+ *
+ *  A dashboard may show thousands of numbers, most of them the same from one frame to the
+ *  next. A field remembers the text it last printed and where it printed it, and skips
+ *  printing the same text again. The field prints again when the colours, attributes or
+ *  clip region it is drawn with change. On a window with a canvas the field also checks
+ *  that the canvas cells still hold its text, so it notices anything drawn over it. On
+ *  other windows it prints again after the window is cleared, filled, resized or
+ *  switched to or from a canvas, but can not tell when other drawing overwrites it, so
+ *  nothing else should draw over it. Components drawing a field should clear around it
+ *  with clearRect rather than clearing the whole window.
+ */
+class NumberField
+{
+public:
+    /** Constructor
+     *
+     *  @param xInit the x position of the field
+     *  @param yInit the y position of the field
+     *  @param formatInit how to lay the number out
+     */
+    NumberField (int xInit, int yInit, const NumberFormat &formatInit = NumberFormat());
+
+    /** Print a floating point number in the field, unless the field already shows it.
+     *
+     *  Returns true if the number was printed. The cursor is left after the field either way.
+     *
+     *  @param session the session to draw with
+     *  @param value the value to print
+     */
+    bool printDouble (Window::DrawSession &session, double value);
+    /** Print an integer in the field, unless the field already shows it.
+     *
+     *  Returns true if the number was printed. The cursor is left after the field either way.
+     *
+     *  @param session the session to draw with
+     *  @param value the value to print
+     */
+    bool printInteger (Window::DrawSession &session, int value);
+
+    /** Move the field. It is printed in full next time. */
+    void setPosition (int newX, int newY);
+    /** Change how the number is laid out. It is printed in full next time. */
+    void setFormat (const NumberFormat &newFormat);
+    /** Make the field print next time whether or not its text has changed. */
+    void invalidate();
+
+    /** Returns the number of columns the field last printed, or 0 if it has not printed. */
+    int getLength() const;
+
+private:
+    bool print (Window::DrawSession &session, const char *text, int length);
+
+    /** Everything besides the text which decides what a printed field looks like. */
+    struct Placement
+    {
+        const Window *window;
+        unsigned long contentVersion;
+        int x, y;
+        int clipLeft, clipTop, clipRight, clipBottom;
+        attr_t attributes;
+        short colourPair;
+        bool usesCanvas;
+
+        bool operator== (const Placement &other) const;
+    };
+
+    /** Returns true if the printed text is still in the window's canvas cells, or if the
+     *  window has no canvas to check.
+     */
+    bool isShownOn (const Window &window, const Placement &placement) const;
+
+    int x, y;
+    NumberFormat format;
+
+    Placement printedPlacement;
+    std::string printedText;
 };
 
 #endif // CURSES_HPP_INCLUDED
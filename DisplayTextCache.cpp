@@ -0,0 +1,204 @@
+#include "DisplayTextCache.hpp"
+#include <wchar.h>
+
+namespace
+{
+    const wchar_t unprintableCharacter = L'?';
+
+    /** Decode one character from UTF-8, returning the number of bytes it used.
+     *  Malformed sequences decode to unprintableCharacter, one byte at a time.
+     */
+    std::size_t decodeCharacter (const unsigned char *bytes, std::size_t length, wchar_t &character)
+    {
+        unsigned char lead = bytes [0];
+
+        if (lead < 0x80)
+        {
+            character = lead;
+            return 1;
+        }
+
+        std::size_t followingBytes;
+        wchar_t minimum;
+
+        if ((lead & 0xe0) == 0xc0)
+        {
+            followingBytes = 1;
+            character = lead & 0x1f;
+            minimum = 0x80;
+        }
+        else if ((lead & 0xf0) == 0xe0)
+        {
+            followingBytes = 2;
+            character = lead & 0x0f;
+            minimum = 0x800;
+        }
+        else if ((lead & 0xf8) == 0xf0)
+        {
+            followingBytes = 3;
+            character = lead & 0x07;
+            minimum = 0x10000;
+        }
+        else
+        {
+            character = unprintableCharacter;
+            return 1;
+        }
+
+        if (followingBytes >= length)
+        {
+            character = unprintableCharacter;
+            return 1;
+        }
+
+        for (std::size_t i = 1; i <= followingBytes; ++i)
+        {
+            if ((bytes [i] & 0xc0) != 0x80)
+            {
+                character = unprintableCharacter;
+                return 1;
+            }
+
+            character = (character << 6) | (bytes [i] & 0x3f);
+        }
+
+        // Overlong encodings, surrogates and values past the end of Unicode are malformed.
+        if (character < minimum || character > 0x10ffff || (character >= 0xd800 && character <= 0xdfff))
+        {
+            character = unprintableCharacter;
+            return 1;
+        }
+
+        return followingBytes + 1;
+    }
+
+    void measure (const std::string &text, DisplayText &displayText)
+    {
+        const unsigned char *bytes = reinterpret_cast <const unsigned char*> (text.data());
+        std::size_t length = text.size();
+
+        displayText.characters.reserve (length);
+        displayText.widths.reserve (length);
+        displayText.markCounts.reserve (length);
+        displayText.width = 0;
+
+        for (std::size_t position = 0; position < length; )
+        {
+            wchar_t character;
+            position += decodeCharacter (bytes + position, length - position, character);
+
+            int width = wcwidth (character);
+
+            if (width == 0)
+            {
+                if (displayText.characters.empty())
+                {
+                    displayText.characters.push_back (L' ');
+                    displayText.widths.push_back (1);
+                    displayText.markCounts.push_back (0);
+                    displayText.width = 1;
+                }
+
+                if (displayText.markCounts.back() < DisplayText::maxCombiningMarks)
+                {
+                    displayText.combiningMarks.push_back (character);
+                    ++displayText.markCounts.back();
+                }
+
+                continue;
+            }
+
+            if (width < 0 || width > 2)
+            {
+                character = unprintableCharacter;
+                width = 1;
+            }
+
+            displayText.characters.push_back (character);
+            displayText.widths.push_back (static_cast <unsigned char> (width));
+            displayText.markCounts.push_back (0);
+            displayText.width += width;
+        }
+    }
+}
+
+const int DisplayText::maxCombiningMarks;
+
+std::size_t DisplayText::countCharactersFitting (int columns) const
+{
+    std::size_t count = 0;
+
+    while (count < widths.size() && widths [count] <= columns)
+    {
+        columns -= widths [count++];
+    }
+
+    return count;
+}
+
+DisplayTextCache::DisplayTextCache (std::size_t capacityInit)
+    : capacity (capacityInit),
+      hits (0), misses (0)
+{
+    entries.reserve (capacity);
+}
+
+DisplayTextCache::~DisplayTextCache()
+{
+}
+
+bool DisplayTextCache::isAscii (const char *text, std::size_t length)
+{
+    unsigned char combined = 0;
+
+    for (std::size_t i = 0; i < length; ++i)
+    {
+        combined |= static_cast <unsigned char> (text [i]);
+    }
+
+    return combined < 0x80;
+}
+
+const DisplayText& DisplayTextCache::getDisplayText (const std::string &text)
+{
+    auto found = entries.find (text);
+
+    if (found != entries.end())
+    {
+        ++hits;
+        return found->second;
+    }
+
+    ++misses;
+
+    if (entries.size() >= capacity)
+    {
+        entries.clear();
+    }
+
+    DisplayText &displayText = entries [text];
+    measure (text, displayText);
+
+    return displayText;
+}
+
+int DisplayTextCache::getWidth (const std::string &text)
+{
+    if (isAscii (text.data(), text.size()))
+    {
+        return static_cast <int> (text.size());
+    }
+
+    return getDisplayText (text).width;
+}
+
+DisplayTextCache::Statistics DisplayTextCache::getStatistics() const
+{
+    return Statistics {hits, misses, entries.size()};
+}
+
+void DisplayTextCache::resetStatistics()
+{
+    hits = 0;
+    misses = 0;
+}
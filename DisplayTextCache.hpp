@@ -0,0 +1,104 @@
+#ifndef DISPLAY_TEXT_CACHE_HPP_INCLUDED
+#define DISPLAY_TEXT_CACHE_HPP_INCLUDED
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <curses.h>
+
+/** A string decoded from UTF-8 into the characters and columns it takes on screen. */
+struct DisplayText
+{
+    /** The most combining marks kept with one character, as many as fit in a cchar_t
+     *  besides the character itself.
+     */
+    static const int maxCombiningMarks = CCHARW_MAX - 1;
+
+    /** The characters of the string. Characters which can not be shown are replaced with
+     *  question marks. Characters which take no columns, such as combining accents, are
+     *  kept with the character before them rather than here.
+     */
+    std::vector <wchar_t> characters;
+    /** The number of columns each character takes, which is 1 or 2. */
+    std::vector <unsigned char> widths;
+    /** The number of combining marks shown in the same cell as each character. */
+    std::vector <unsigned char> markCounts;
+    /** The combining marks of every character in turn. A mark at the start of the string
+     *  is shown over a blank. Marks past maxCombiningMarks for one character are dropped.
+     */
+    std::vector <wchar_t> combiningMarks;
+    /** The number of columns the whole string takes. */
+    int width;
+
+    /** Returns how many characters from the start of the string fit in a number of columns.
+     *
+     *  @param columns the number of columns available
+     */
+    std::size_t countCharactersFitting (int columns) const;
+};
+
+/** Measures strings for display, remembering the strings it has measured.
+ *
+ *  Labels are usually drawn every frame with the same text, so decoding them and looking
+ *  up the width of each character is only done the first time a string is seen. When the
+ *  cache is full it is emptied and starts again.
+ *
+ *  Widths come from wcwidth, so they depend on the locale's character type.
+ *
+ *  Callers must hold a Curses::Lock.
+ */
+class DisplayTextCache
+{
+public:
+    /** Constructor
+     *
+     *  @param capacityInit the number of strings to remember
+     */
+    explicit DisplayTextCache (std::size_t capacityInit);
+    /** Destructor */
+    ~DisplayTextCache();
+
+    /** Returns true if a string is plain ASCII, so each byte takes one column.
+     *
+     *  @param text the string to check
+     *  @param length the number of bytes in the string
+     */
+    static bool isAscii (const char *text, std::size_t length);
+
+    /** Returns the decoded form of a string.
+     *
+     *  The result is only valid until the cache is next used.
+     *
+     *  @param text a UTF-8 string
+     */
+    const DisplayText& getDisplayText (const std::string &text);
+    /** Returns the number of columns a string takes. ASCII strings are not cached.
+     *
+     *  @param text a UTF-8 string
+     */
+    int getWidth (const std::string &text);
+
+    /** Counts of how the cache has been used. */
+    struct Statistics
+    {
+        long hits; /**< The number of lookups which found the string already measured. */
+        long misses; /**< The number of lookups which had to measure the string. */
+        std::size_t entries; /**< The number of strings in the cache. */
+    };
+
+    /** Returns counts of how the cache has been used. */
+    Statistics getStatistics() const;
+    /** Set the hit and miss counts back to zero. */
+    void resetStatistics();
+
+private:
+    DisplayTextCache (const DisplayTextCache&) = delete;
+    DisplayTextCache& operator= (const DisplayTextCache&) = delete;
+
+    std::size_t capacity;
+    std::unordered_map <std::string, DisplayText> entries;
+
+    long hits, misses;
+};
+
+#endif // DISPLAY_TEXT_CACHE_HPP_INCLUDED
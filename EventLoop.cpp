@@ -0,0 +1,282 @@
+#include "EventLoop.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include "Curses.hpp"
+#include "RepaintManager.hpp"
+
+namespace
+{
+    /** Set by the SIGWINCH handler, which also writes to the running loop's eventfd. */
+    volatile std::sig_atomic_t resizeSignalled = 0;
+    int signalWakeFd = -1;
+
+    void handleResizeSignal (int)
+    {
+        int savedErrno = errno;
+
+        resizeSignalled = 1;
+        std::uint64_t one = 1;
+        ssize_t ignored = write (signalWakeFd, &one, sizeof (one));
+        (void) ignored;
+
+        errno = savedErrno;
+    }
+}
+
+EventLoop::EventLoop (std::size_t taskQueueCapacity)
+    : timerFd (timerfd_create (CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)),
+      wakeFd (eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK)),
+      resizeDelay (std::chrono::milliseconds (50)),
+      resizeDeadline (TimerService::Clock::time_point::max()),
+      taskQueue (taskQueueCapacity),
+      quitRequested (false),
+      cycles (0), keysRead (0), keysDispatched (0), timerExpirations (0),
+      tasksRun (0), tasksDropped (0), framesPainted (0),
+      resizeSignals (0), resizesHandled (0)
+{
+}
+
+EventLoop::~EventLoop()
+{
+    close (timerFd);
+    close (wakeFd);
+}
+
+void EventLoop::setKeyHandler (const KeyHandler &newKeyHandler)
+{
+    keyHandler = newKeyHandler;
+}
+
+void EventLoop::setResizeHandler (const ResizeHandler &newResizeHandler)
+{
+    resizeHandler = newResizeHandler;
+}
+
+void EventLoop::setResizeDelay (const std::chrono::nanoseconds &newResizeDelay)
+{
+    resizeDelay = newResizeDelay;
+}
+
+bool EventLoop::post (const Task &task)
+{
+    if (! taskQueue.push (task))
+    {
+        tasksDropped.fetch_add (1, std::memory_order_relaxed);
+        return false;
+    }
+
+    wake();
+    return true;
+}
+
+void EventLoop::run()
+{
+    TimerService &timerService = TimerService::getInstance();
+    timerService.attach ([this] () {wake();});
+
+    struct sigaction resizeAction {}, previousResizeAction {};
+    resizeAction.sa_handler = handleResizeSignal;
+    sigemptyset (&resizeAction.sa_mask);
+
+    signalWakeFd = wakeFd;
+    resizeSignalled = 0;
+    sigaction (SIGWINCH, &resizeAction, &previousResizeAction);
+
+    pollfd descriptors [3] = {{STDIN_FILENO, POLLIN, 0},
+                              {timerFd, POLLIN, 0},
+                              {wakeFd, POLLIN, 0}};
+
+    while (true)
+    {
+        runTasks();
+        TimerService::Clock::time_point deadline = timerService.processDueTimers();
+        bool screenResized = false;
+
+        if (resizeDeadline <= TimerService::Clock::now())
+        {
+            screenResized = handleResize();
+        }
+
+        if (RepaintManager::getInstance().paintDirtyComponents() > 0)
+        {
+            framesPainted.fetch_add (1, std::memory_order_relaxed);
+        }
+        else if (screenResized)
+        {
+            Curses::Lock lock;
+            Curses::getInstance().refreshScreen();
+        }
+
+        if (quitRequested.exchange (false))
+        {
+            break;
+        }
+
+        armTimer (std::min (deadline, resizeDeadline));
+
+        // Signals interrupt the poll, which just starts another cycle.
+        if (poll (descriptors, 3, -1) < 0)
+        {
+            continue;
+        }
+
+        cycles.fetch_add (1, std::memory_order_relaxed);
+        std::uint64_t count = 0;
+
+        if (descriptors [1].revents & POLLIN)
+        {
+            if (read (timerFd, &count, sizeof (count)) == sizeof (count))
+            {
+                timerExpirations.fetch_add (1, std::memory_order_relaxed);
+            }
+        }
+
+        if (descriptors [2].revents & POLLIN)
+        {
+            eventfd_read (wakeFd, &count);
+        }
+
+        // Each signal pushes the deadline back, so a burst is handled once it has ended.
+        if (resizeSignalled)
+        {
+            resizeSignalled = 0;
+            resizeSignals.fetch_add (1, std::memory_order_relaxed);
+            resizeDeadline = TimerService::Clock::now() + resizeDelay;
+        }
+
+        if (descriptors [0].revents & POLLIN)
+        {
+            dispatchKeys();
+        }
+    }
+
+    sigaction (SIGWINCH, &previousResizeAction, nullptr);
+    signalWakeFd = -1;
+
+    armTimer (TimerService::Clock::time_point::max());
+    timerService.detach();
+}
+
+void EventLoop::quit()
+{
+    quitRequested = true;
+    wake();
+}
+
+EventLoop::Statistics EventLoop::getStatistics() const
+{
+    return Statistics {cycles.load(),
+                       keysRead.load(),
+                       keysDispatched.load(),
+                       timerExpirations.load(),
+                       tasksRun.load(),
+                       tasksDropped.load(),
+                       framesPainted.load(),
+                       resizeSignals.load(),
+                       resizesHandled.load()};
+}
+
+void EventLoop::wake()
+{
+    eventfd_write (wakeFd, 1);
+}
+
+void EventLoop::armTimer (TimerService::Clock::time_point deadline)
+{
+    itimerspec expiry {};
+
+    // A zero expiry disarms the timer, which is what is wanted when nothing is scheduled.
+    if (deadline != TimerService::Clock::time_point::max())
+    {
+        auto sinceEpoch = std::chrono::duration_cast <std::chrono::nanoseconds> (deadline.time_since_epoch());
+        expiry.it_value.tv_sec = static_cast <time_t> (sinceEpoch.count() / 1000000000);
+        expiry.it_value.tv_nsec = static_cast <long> (sinceEpoch.count() % 1000000000);
+    }
+
+    timerfd_settime (timerFd, TFD_TIMER_ABSTIME, &expiry, nullptr);
+}
+
+void EventLoop::dispatchKeys()
+{
+    pendingKeys.clear();
+
+    {
+        Curses::Lock lock;
+        Curses::Instance curses = Curses::getInstance();
+        int key;
+
+        while ((key = curses.readKey()) != ERR)
+        {
+            pendingKeys.push_back (key);
+        }
+    }
+
+    keysRead.fetch_add (static_cast <long> (pendingKeys.size()), std::memory_order_relaxed);
+
+    std::size_t runStart = 0;
+
+    while (runStart < pendingKeys.size())
+    {
+        int key = pendingKeys [runStart];
+        std::size_t runEnd = runStart + 1;
+
+        // Resize and mouse events carry state which is read when they are handled, so
+        // they are never merged.
+        if (key != KEY_RESIZE && key != KEY_MOUSE)
+        {
+            while (runEnd < pendingKeys.size() && pendingKeys [runEnd] == key)
+            {
+                ++runEnd;
+            }
+        }
+
+        keysDispatched.fetch_add (1, std::memory_order_relaxed);
+
+        if (keyHandler)
+        {
+            keyHandler (key, static_cast <int> (runEnd - runStart));
+        }
+
+        runStart = runEnd;
+    }
+}
+
+void EventLoop::runTasks()
+{
+    Task task;
+
+    while (taskQueue.pop (task))
+    {
+        task();
+        task = nullptr;
+        tasksRun.fetch_add (1, std::memory_order_relaxed);
+    }
+}
+
+bool EventLoop::handleResize()
+{
+    resizeDeadline = TimerService::Clock::time_point::max();
+
+    Curses::Instance curses = Curses::getInstance();
+
+    if (! curses.updateScreenSize())
+    {
+        return false;
+    }
+
+    resizesHandled.fetch_add (1, std::memory_order_relaxed);
+
+    if (resizeHandler)
+    {
+        resizeHandler (curses.getScreenWidth(), curses.getScreenHeight());
+    }
+
+    return true;
+}
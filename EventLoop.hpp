@@ -0,0 +1,126 @@
+#ifndef EVENT_LOOP_HPP_INCLUDED
+#define EVENT_LOOP_HPP_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include "CommandQueue.hpp"
+#include "TimerService.hpp"
+
+/** A single threaded loop which dispatches key presses, timer callbacks and posted tasks.
+ *
+ *  run() polls three file descriptors: stdin for key presses, a timerfd armed with the
+ *  deadline of the next due Timer, and an eventfd which other threads write to when they
+ *  post a task or change a timer. While the loop is running every Timer callback is called
+ *  from the loop's thread rather than the TimerService thread.
+ *
+ *  When stdin becomes readable all pending input is drained at once, and each run of
+ *  identical keys is passed to the key handler as a single key with a repeat count, so a
+ *  burst of auto-repeated keys causes one state change and one repaint.
+ *
+ *  While the loop is running it handles SIGWINCH itself. A burst of resize signals is
+ *  debounced into a single resize, which resizes the ncurses screen and then calls the
+ *  resize handler once, so components are only laid out again when the terminal size has
+ *  settled.
+ *
+ *  At the end of each cycle the loop paints any components invalidated while dispatching,
+ *  so anything posted becomes visible within one cycle. As the loop's thread is the only
+ *  one touching components and ncurses, the Curses lock is never contended.
+ *
+ *  This uses timerfd and eventfd, so is only available on Linux.
+ */
+class EventLoop
+{
+public:
+    /** Constructor
+     *
+     *  @param taskQueueCapacity the number of tasks which can be waiting for the loop
+     */
+    explicit EventLoop (std::size_t taskQueueCapacity = 4096);
+    /** Destructor */
+    ~EventLoop();
+
+    /** A function called with each run of identical keys read from the terminal. */
+    using KeyHandler = std::function <void (int key, int repeatCount)>;
+    /** A function posted to run on the loop's thread. */
+    using Task = std::function <void()>;
+    /** A function called with the new size of the terminal after it has been resized. */
+    using ResizeHandler = std::function <void (int screenWidth, int screenHeight)>;
+
+    /** Set the function to call with each run of identical keys read from the terminal.
+     *
+     *  @param newKeyHandler the function to call with each key and its repeat count
+     */
+    void setKeyHandler (const KeyHandler &newKeyHandler);
+    /** Set the function to call once the terminal has been resized.
+     *
+     *  @param newResizeHandler the function to call with the new terminal size
+     */
+    void setResizeHandler (const ResizeHandler &newResizeHandler);
+    /** Set how long the terminal must go without being resized before a resize is handled.
+     *
+     *  @param newResizeDelay the time to wait after the last resize signal
+     */
+    void setResizeDelay (const std::chrono::nanoseconds &newResizeDelay);
+
+    /** Queue a task to be run on the loop's thread during the next cycle.
+     *
+     *  May be called from any thread and never blocks. Returns false if the queue was full
+     *  and the task was dropped.
+     *
+     *  @param task the task to run
+     */
+    bool post (const Task &task);
+
+    /** Run the loop on the calling thread until quit() is called. */
+    void run();
+    /** Make run() return at the end of the current cycle. May be called from any thread. */
+    void quit();
+
+    /** Counts of the work the loop has done. */
+    struct Statistics
+    {
+        long cycles; /**< The number of times the loop has woken up. */
+        long keysRead; /**< The number of keys read from the terminal. */
+        long keysDispatched; /**< The number of times the key handler has been called. */
+        long timerExpirations; /**< The number of times the timerfd has expired. */
+        long tasksRun; /**< The number of posted tasks run. */
+        long tasksDropped; /**< The number of tasks dropped because the queue was full. */
+        long framesPainted; /**< The number of cycles in which components were painted. */
+        long resizeSignals; /**< The number of resize signals received. */
+        long resizesHandled; /**< The number of times the resize handler has been called. */
+    };
+
+    /** Returns counts of the work the loop has done. */
+    Statistics getStatistics() const;
+
+private:
+    EventLoop (const EventLoop&) = delete;
+    EventLoop& operator= (const EventLoop&) = delete;
+
+    int timerFd, wakeFd;
+
+    KeyHandler keyHandler;
+    std::vector <int> pendingKeys;
+
+    ResizeHandler resizeHandler;
+    std::chrono::nanoseconds resizeDelay;
+    TimerService::Clock::time_point resizeDeadline;
+
+    CommandQueue <Task> taskQueue;
+    std::atomic <bool> quitRequested;
+
+    std::atomic <long> cycles, keysRead, keysDispatched, timerExpirations;
+    std::atomic <long> tasksRun, tasksDropped, framesPainted;
+    std::atomic <long> resizeSignals, resizesHandled;
+
+    void wake();
+    void armTimer (TimerService::Clock::time_point deadline);
+    void dispatchKeys();
+    void runTasks();
+    bool handleResize();
+};
+
+#endif // EVENT_LOOP_HPP_INCLUDED
@@ -0,0 +1,175 @@
+#include "Layout.hpp"
+#include <algorithm>
+#include <cmath>
+#include "Component.hpp"
+
+Layout::Layout (Direction directionInit)
+    : direction (directionInit),
+      padding (0), spacing (0),
+      owner (nullptr),
+      constraintsChanged (true),
+      appliedWidth (-1), appliedHeight (-1)
+{
+}
+
+Layout::~Layout()
+{
+    if (owner != nullptr)
+    {
+        owner->setLayout (nullptr);
+    }
+}
+
+void Layout::setDirection (Direction newDirection)
+{
+    direction = newDirection;
+    constraintsDidChange();
+}
+
+void Layout::setPadding (int newPadding)
+{
+    padding = std::max (newPadding, 0);
+    constraintsDidChange();
+}
+
+void Layout::setSpacing (int newSpacing)
+{
+    spacing = std::max (newSpacing, 0);
+    constraintsDidChange();
+}
+
+void Layout::addFixed (Component &component, int size)
+{
+    items.push_back (Item {&component, false, static_cast <double> (std::max (size, 0)), -1});
+    constraintsDidChange();
+}
+
+void Layout::addProportional (Component &component, double weight)
+{
+    items.push_back (Item {&component, true, std::max (weight, 0.0), -1});
+    constraintsDidChange();
+}
+
+void Layout::setCrossSize (Component &component, int crossSize)
+{
+    for (auto &item : items)
+    {
+        if (item.component == &component)
+        {
+            item.crossSize = crossSize;
+        }
+    }
+
+    constraintsDidChange();
+}
+
+void Layout::removeComponent (Component &component)
+{
+    items.erase (std::remove_if (items.begin(), items.end(),
+                                 [&component] (const Item &item) {return item.component == &component;}),
+                 items.end());
+    constraintsDidChange();
+}
+
+bool Layout::needsLayout (int width, int height) const
+{
+    return constraintsChanged || width != appliedWidth || height != appliedHeight;
+}
+
+void Layout::apply (int width, int height)
+{
+    if (! needsLayout (width, height))
+    {
+        return;
+    }
+
+    bool isRow = direction == Direction::row;
+    int length = isRow ? width : height;
+    int crossLength = std::max ((isRow ? height : width) - 2 * padding, 0);
+
+    // The positions along the layout direction only change with the length, so a change
+    // in the other dimension reuses them.
+    if (constraintsChanged || length != (isRow ? appliedWidth : appliedHeight))
+    {
+        computeItemSizes (length);
+    }
+
+    constraintsChanged = false;
+    appliedWidth = width;
+    appliedHeight = height;
+
+    for (std::size_t i = 0; i < items.size(); ++i)
+    {
+        const Item &item = items [i];
+        int itemCross = item.crossSize < 0 ? crossLength : std::min (item.crossSize, crossLength);
+
+        if (isRow)
+        {
+            item.component->setBounds (itemStarts [i], padding, itemSizes [i], itemCross);
+        }
+        else
+        {
+            item.component->setBounds (padding, itemStarts [i], itemCross, itemSizes [i]);
+        }
+    }
+}
+
+void Layout::constraintsDidChange()
+{
+    constraintsChanged = true;
+
+    if (owner != nullptr)
+    {
+        owner->invalidateLayout();
+    }
+}
+
+void Layout::computeItemSizes (int length)
+{
+    int numItems = static_cast <int> (items.size());
+    int available = length - 2 * padding - spacing * std::max (numItems - 1, 0);
+    double totalWeight = 0.0;
+
+    for (const auto &item : items)
+    {
+        if (item.proportional)
+        {
+            totalWeight += item.size;
+        }
+        else
+        {
+            available -= static_cast <int> (item.size);
+        }
+    }
+
+    available = std::max (available, 0);
+
+    itemStarts.resize (numItems);
+    itemSizes.resize (numItems);
+
+    // Proportional sizes are rounded from the running total of the weights, so the
+    // rounding errors never add up to more than a cell.
+    double weightSoFar = 0.0;
+    int proportionalSoFar = 0;
+    int position = padding;
+
+    for (int i = 0; i < numItems; ++i)
+    {
+        const Item &item = items [i];
+        int size = static_cast <int> (item.size);
+
+        if (item.proportional)
+        {
+            weightSoFar += item.size;
+            int proportionalEnd = totalWeight > 0.0
+                                  ? static_cast <int> (std::lround (available * weightSoFar / totalWeight))
+                                  : 0;
+            size = proportionalEnd - proportionalSoFar;
+            proportionalSoFar = proportionalEnd;
+        }
+
+        itemStarts [i] = position;
+        itemSizes [i] = size;
+        position += size + spacing;
+    }
+}
@@ -0,0 +1,122 @@
+#ifndef LAYOUT_HPP_INCLUDED
+#define LAYOUT_HPP_INCLUDED
+
+#include <vector>
+
+class Component;
+
+/** Arranges child components in a single row or column.
+ *
+ *  Each item is given either a fixed size or a share of the space left over once the
+ *  fixed items, padding and spacing have been taken out. Along the other axis items fill
+ *  the available space, unless they have been given a smaller cross size.
+ *
+ *  A layout is attached to its parent component with Component::setLayout(). The bounds
+ *  it computes are cached, so applying it again is free unless its constraints or the
+ *  size of the parent have changed, and only the items whose bounds actually move are
+ *  told about it.
+ */
+class Layout
+{
+public:
+    /** The direction in which items are placed. */
+    enum class Direction
+    {
+        row, /**< Items are placed left to right. */
+        column /**< Items are placed top to bottom. */
+    };
+
+    /** Constructor
+     *
+     *  @param directionInit the direction in which to place items
+     */
+    explicit Layout (Direction directionInit = Direction::column);
+    /** Destructor */
+    ~Layout();
+
+    /** Set the direction in which items are placed.
+     *
+     *  @param newDirection the new direction
+     */
+    void setDirection (Direction newDirection);
+    /** Set the space left between the edges of the parent and the items.
+     *
+     *  @param newPadding the padding in cells
+     */
+    void setPadding (int newPadding);
+    /** Set the space left between neighbouring items.
+     *
+     *  @param newSpacing the spacing in cells
+     */
+    void setSpacing (int newSpacing);
+
+    /** Add an item with a fixed size along the layout direction.
+     *
+     *  @param component the component to place, which should be a child of the parent
+     *  @param size the size of the item in cells
+     */
+    void addFixed (Component &component, int size);
+    /** Add an item which takes a share of the space left over by the fixed items.
+     *
+     *  @param component the component to place, which should be a child of the parent
+     *  @param weight the size of the item's share relative to the other shares
+     */
+    void addProportional (Component &component, double weight = 1.0);
+    /** Limit the size of an item across the layout direction.
+     *
+     *  @param component the component to limit
+     *  @param crossSize the most cells the item may take, or a negative number to fill
+     *                   the available space
+     */
+    void setCrossSize (Component &component, int crossSize);
+    /** Remove an item.
+     *
+     *  @param component the component to remove
+     */
+    void removeComponent (Component &component);
+
+    /** Returns true if applying the layout to an area of this size would move anything.
+     *
+     *  @param width the width of the area
+     *  @param height the height of the area
+     */
+    bool needsLayout (int width, int height) const;
+    /** Set the bounds of every item to fit an area of the given size.
+     *
+     *  Does nothing if neither the constraints nor the size have changed since the layout
+     *  was last applied.
+     *
+     *  @param width the width of the area
+     *  @param height the height of the area
+     */
+    void apply (int width, int height);
+
+private:
+    Layout (const Layout&) = delete;
+    Layout& operator= (const Layout&) = delete;
+
+    struct Item
+    {
+        Component *component;
+        bool proportional;
+        double size;
+        int crossSize;
+    };
+
+    Direction direction;
+    int padding, spacing;
+    std::vector <Item> items;
+
+    Component *owner;
+    bool constraintsChanged;
+    int appliedWidth, appliedHeight;
+
+    std::vector <int> itemStarts, itemSizes;
+
+    void constraintsDidChange();
+    void computeItemSizes (int length);
+
+    friend class Component;
+};
+
+#endif // LAYOUT_HPP_INCLUDED
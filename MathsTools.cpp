@@ -0,0 +1,278 @@
+#include "MathsTools.hpp"
+
+#if defined (__x86_64__) || defined (__i386__)
+#include <immintrin.h>
+#define MATHS_TOOLS_X86 1
+#else
+#define MATHS_TOOLS_X86 0
+#endif
+
+namespace
+{
+    // Each kernel works on as many whole vectors as it can and leaves the rest to the
+    // scalar kernel, so all three give exactly the same results.
+
+    void clampScalar (const double *input, double *output, std::size_t length,
+                      double minValue, double maxValue)
+    {
+        for (std::size_t i = 0; i < length; ++i)
+        {
+            output [i] = MathsTools::constrictValueToRange (input [i], minValue, maxValue);
+        }
+    }
+
+    void normaliseScalar (const double *input, double *output, std::size_t length,
+                          double bottomValue, double range)
+    {
+        for (std::size_t i = 0; i < length; ++i)
+        {
+            output [i] = MathsTools::constrictValueToRange ((input [i] - bottomValue) / range, 0.0, 1.0);
+        }
+    }
+
+    void cellCountsScalar (const double *proportions, int *cellCounts, std::size_t length, int numCells)
+    {
+        for (std::size_t i = 0; i < length; ++i)
+        {
+            double proportion = proportions [i];
+            proportion = proportion > 0.0 ? proportion : 0.0;
+            proportion = proportion < 1.0 ? proportion : 1.0;
+            cellCounts [i] = static_cast <int> (proportion * numCells);
+        }
+    }
+
+#if MATHS_TOOLS_X86
+    // These match constrictValueToRange() exactly: values equal to a boundary become the
+    // boundary, which matters for the sign of zero, and NaNs are passed through.
+
+    __attribute__ ((target ("sse2")))
+    inline __m128d constrictSse2 (__m128d value, __m128d minimum, __m128d maximum)
+    {
+        __m128d constricted = _mm_min_pd (_mm_max_pd (value, minimum), maximum);
+        __m128d isNan = _mm_cmpunord_pd (value, value);
+
+        return _mm_or_pd (_mm_and_pd (isNan, value), _mm_andnot_pd (isNan, constricted));
+    }
+
+    __attribute__ ((target ("avx2")))
+    inline __m256d constrictAvx2 (__m256d value, __m256d minimum, __m256d maximum)
+    {
+        __m256d constricted = _mm256_min_pd (_mm256_max_pd (value, minimum), maximum);
+        __m256d isNan = _mm256_cmp_pd (value, value, _CMP_UNORD_Q);
+
+        return _mm256_blendv_pd (constricted, value, isNan);
+    }
+
+    __attribute__ ((target ("sse2")))
+    void clampSse2 (const double *input, double *output, std::size_t length,
+                    double minValue, double maxValue)
+    {
+        __m128d minimum = _mm_set1_pd (minValue);
+        __m128d maximum = _mm_set1_pd (maxValue);
+        std::size_t i = 0;
+
+        for (; i + 2 <= length; i += 2)
+        {
+            __m128d value = _mm_loadu_pd (input + i);
+            value = constrictSse2 (value, minimum, maximum);
+            _mm_storeu_pd (output + i, value);
+        }
+
+        clampScalar (input + i, output + i, length - i, minValue, maxValue);
+    }
+
+    __attribute__ ((target ("sse2")))
+    void normaliseSse2 (const double *input, double *output, std::size_t length,
+                        double bottomValue, double range)
+    {
+        __m128d bottom = _mm_set1_pd (bottomValue);
+        __m128d divisor = _mm_set1_pd (range);
+        __m128d zero = _mm_setzero_pd();
+        __m128d one = _mm_set1_pd (1.0);
+        std::size_t i = 0;
+
+        for (; i + 2 <= length; i += 2)
+        {
+            __m128d value = _mm_div_pd (_mm_sub_pd (_mm_loadu_pd (input + i), bottom), divisor);
+            value = constrictSse2 (value, zero, one);
+            _mm_storeu_pd (output + i, value);
+        }
+
+        normaliseScalar (input + i, output + i, length - i, bottomValue, range);
+    }
+
+    __attribute__ ((target ("sse2")))
+    void cellCountsSse2 (const double *proportions, int *cellCounts, std::size_t length, int numCells)
+    {
+        __m128d zero = _mm_setzero_pd();
+        __m128d one = _mm_set1_pd (1.0);
+        __m128d scale = _mm_set1_pd (numCells);
+        std::size_t i = 0;
+
+        // The maximum instruction returns its second operand when either is a NaN, so a
+        // NaN becomes 0 and fills no cells.
+        for (; i + 2 <= length; i += 2)
+        {
+            __m128d proportion = _mm_min_pd (_mm_max_pd (_mm_loadu_pd (proportions + i), zero), one);
+            __m128i counts = _mm_cvttpd_epi32 (_mm_mul_pd (proportion, scale));
+            _mm_storel_epi64 (reinterpret_cast <__m128i*> (cellCounts + i), counts);
+        }
+
+        cellCountsScalar (proportions + i, cellCounts + i, length - i, numCells);
+    }
+
+    __attribute__ ((target ("avx2")))
+    void clampAvx2 (const double *input, double *output, std::size_t length,
+                    double minValue, double maxValue)
+    {
+        __m256d minimum = _mm256_set1_pd (minValue);
+        __m256d maximum = _mm256_set1_pd (maxValue);
+        std::size_t i = 0;
+
+        for (; i + 4 <= length; i += 4)
+        {
+            __m256d value = _mm256_loadu_pd (input + i);
+            value = constrictAvx2 (value, minimum, maximum);
+            _mm256_storeu_pd (output + i, value);
+        }
+
+        clampScalar (input + i, output + i, length - i, minValue, maxValue);
+    }
+
+    __attribute__ ((target ("avx2")))
+    void normaliseAvx2 (const double *input, double *output, std::size_t length,
+                        double bottomValue, double range)
+    {
+        __m256d bottom = _mm256_set1_pd (bottomValue);
+        __m256d divisor = _mm256_set1_pd (range);
+        __m256d zero = _mm256_setzero_pd();
+        __m256d one = _mm256_set1_pd (1.0);
+        std::size_t i = 0;
+
+        for (; i + 4 <= length; i += 4)
+        {
+            __m256d value = _mm256_div_pd (_mm256_sub_pd (_mm256_loadu_pd (input + i), bottom), divisor);
+            value = constrictAvx2 (value, zero, one);
+            _mm256_storeu_pd (output + i, value);
+        }
+
+        normaliseScalar (input + i, output + i, length - i, bottomValue, range);
+    }
+
+    __attribute__ ((target ("avx2")))
+    void cellCountsAvx2 (const double *proportions, int *cellCounts, std::size_t length, int numCells)
+    {
+        __m256d zero = _mm256_setzero_pd();
+        __m256d one = _mm256_set1_pd (1.0);
+        __m256d scale = _mm256_set1_pd (numCells);
+        std::size_t i = 0;
+
+        for (; i + 4 <= length; i += 4)
+        {
+            __m256d proportion = _mm256_min_pd (_mm256_max_pd (_mm256_loadu_pd (proportions + i), zero), one);
+            __m128i counts = _mm256_cvttpd_epi32 (_mm256_mul_pd (proportion, scale));
+            _mm_storeu_si128 (reinterpret_cast <__m128i*> (cellCounts + i), counts);
+        }
+
+        cellCountsScalar (proportions + i, cellCounts + i, length - i, numCells);
+    }
+#endif
+
+    MathsTools::SpanInstructions findBestSpanInstructions()
+    {
+#if MATHS_TOOLS_X86
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports ("avx2"))
+        {
+            return MathsTools::SpanInstructions::avx2;
+        }
+
+        if (__builtin_cpu_supports ("sse2"))
+        {
+            return MathsTools::SpanInstructions::sse2;
+        }
+#endif
+
+        return MathsTools::SpanInstructions::scalar;
+    }
+
+    MathsTools::SpanInstructions getSupportedSpanInstructions (MathsTools::SpanInstructions instructions)
+    {
+        return std::min (instructions, MathsTools::getBestSpanInstructions());
+    }
+}
+
+MathsTools::SpanInstructions MathsTools::getBestSpanInstructions()
+{
+    static const SpanInstructions best = findBestSpanInstructions();
+    return best;
+}
+
+void MathsTools::clampSpan (const double *input, double *output, std::size_t length,
+                            double bottomValue, double topValue, SpanInstructions instructions)
+{
+    double minValue = std::min (bottomValue, topValue);
+    double maxValue = std::max (bottomValue, topValue);
+
+    switch (getSupportedSpanInstructions (instructions))
+    {
+#if MATHS_TOOLS_X86
+        case SpanInstructions::avx2:
+            clampAvx2 (input, output, length, minValue, maxValue);
+            break;
+
+        case SpanInstructions::sse2:
+            clampSse2 (input, output, length, minValue, maxValue);
+            break;
+#endif
+
+        default:
+            clampScalar (input, output, length, minValue, maxValue);
+            break;
+    }
+}
+
+void MathsTools::normaliseSpan (const double *input, double *output, std::size_t length,
+                                double bottomValue, double topValue, SpanInstructions instructions)
+{
+    double range = topValue - bottomValue;
+
+    switch (getSupportedSpanInstructions (instructions))
+    {
+#if MATHS_TOOLS_X86
+        case SpanInstructions::avx2:
+            normaliseAvx2 (input, output, length, bottomValue, range);
+            break;
+
+        case SpanInstructions::sse2:
+            normaliseSse2 (input, output, length, bottomValue, range);
+            break;
+#endif
+
+        default:
+            normaliseScalar (input, output, length, bottomValue, range);
+            break;
+    }
+}
+
+void MathsTools::proportionsToCellCounts (const double *proportions, int *cellCounts, std::size_t length,
+                                          int numCells, SpanInstructions instructions)
+{
+    switch (getSupportedSpanInstructions (instructions))
+    {
+#if MATHS_TOOLS_X86
+        case SpanInstructions::avx2:
+            cellCountsAvx2 (proportions, cellCounts, length, numCells);
+            break;
+
+        case SpanInstructions::sse2:
+            cellCountsSse2 (proportions, cellCounts, length, numCells);
+            break;
+#endif
+
+        default:
+            cellCountsScalar (proportions, cellCounts, length, numCells);
+            break;
+    }
+}
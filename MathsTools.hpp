@@ -1,6 +1,10 @@
 #ifndef MATHS_TOOLS_HPP_INCLUDED
 #define MATHS_TOOLS_HPP_INCLUDED
 
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
 /** Some useful maths functions. */
 struct MathsTools
 {
@@ -42,6 +46,88 @@ struct MathsTools
         }
     }
 
+    /** Raise a value to a positive whole power with a chain of multiplications.
+     *
+     *  @param value the input value
+     */
+    template <int Exponent, typename T>
+    static constexpr T integerPower (T value)
+    {
+        static_assert (Exponent > 0, "The exponent must be positive");
+
+        T result = value;
+
+        for (int i = 1; i < Exponent; ++i)
+        {
+            result *= value;
+        }
+
+        return result;
+    }
+
+    /** The instruction sets the span functions can be implemented with. */
+    enum class SpanInstructions
+    {
+        scalar, /**< Plain C++, one value at a time. */
+        sse2, /**< SSE2, two values at a time. */
+        avx2 /**< AVX2, four values at a time. */
+    };
+
+    /** Returns the best instruction set the processor supports.
+     *
+     *  The span functions use this unless told otherwise. The processor is only asked once.
+     */
+    static SpanInstructions getBestSpanInstructions();
+
+    /** Constrict every value in a span to a given range.
+     *
+     *  This gives the same results as constrictValueToRange(), so NaNs are passed through.
+     *  The input and output may be the same span.
+     *
+     *  @param input the values to constrict
+     *  @param output where to write the constricted values
+     *  @param length the number of values
+     *  @param bottomValue one of the range boundaries
+     *  @param topValue the other range boundary
+     *  @param instructions the instruction set to use, which falls back to the best one
+     *                      supported if the processor does not support it
+     */
+    static void clampSpan (const double *input, double *output, std::size_t length,
+                           double bottomValue, double topValue,
+                           SpanInstructions instructions = getBestSpanInstructions());
+
+    /** Convert every value in a span to a proportion of the way through a range.
+     *
+     *  The bottom of the range becomes 0 and the top 1, and the results are constricted to
+     *  0 to 1. The input and output may be the same span.
+     *
+     *  @param input the values to convert
+     *  @param output where to write the proportions
+     *  @param length the number of values
+     *  @param bottomValue the value which becomes 0
+     *  @param topValue the value which becomes 1
+     *  @param instructions the instruction set to use, which falls back to the best one
+     *                      supported if the processor does not support it
+     */
+    static void normaliseSpan (const double *input, double *output, std::size_t length,
+                               double bottomValue, double topValue,
+                               SpanInstructions instructions = getBestSpanInstructions());
+
+    /** Convert every proportion in a span to the number of whole cells it fills.
+     *
+     *  Proportions are constricted to 0 to 1 first, and NaNs fill no cells.
+     *
+     *  @param proportions the proportions to convert
+     *  @param cellCounts where to write the number of cells filled
+     *  @param length the number of proportions
+     *  @param numCells the number of cells a proportion of 1 fills
+     *  @param instructions the instruction set to use, which falls back to the best one
+     *                      supported if the processor does not support it
+     */
+    static void proportionsToCellCounts (const double *proportions, int *cellCounts, std::size_t length,
+                                         int numCells,
+                                         SpanInstructions instructions = getBestSpanInstructions());
+
 private:
     template <typename T>
     static int sign (T value, std::true_type)
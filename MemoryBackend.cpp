@@ -0,0 +1,639 @@
+#include "MemoryBackend.hpp"
+#include <algorithm>
+#include <wchar.h>
+
+namespace
+{
+    const MemoryBackend::Cell blankCell {L' ', A_NORMAL, 0};
+
+    /** The letters of the VT100 line drawing characters, which the ACS_ macros look up. */
+    const char lineDrawingLetters [] = "+,-.0`afghijklmnopqrstuvwxyz{|}~";
+
+    void appendUtf8 (std::string &text, wchar_t character)
+    {
+        unsigned long code = static_cast <unsigned long> (character);
+
+        if (code < 0x80)
+        {
+            text += static_cast <char> (code);
+        }
+        else if (code < 0x800)
+        {
+            text += static_cast <char> (0xc0 | (code >> 6));
+            text += static_cast <char> (0x80 | (code & 0x3f));
+        }
+        else if (code < 0x10000)
+        {
+            text += static_cast <char> (0xe0 | (code >> 12));
+            text += static_cast <char> (0x80 | ((code >> 6) & 0x3f));
+            text += static_cast <char> (0x80 | (code & 0x3f));
+        }
+        else
+        {
+            text += static_cast <char> (0xf0 | (code >> 18));
+            text += static_cast <char> (0x80 | ((code >> 12) & 0x3f));
+            text += static_cast <char> (0x80 | ((code >> 6) & 0x3f));
+            text += static_cast <char> (0x80 | (code & 0x3f));
+        }
+    }
+}
+
+/** A window kept in memory, which follows the same rules for drawing as an ncurses window. */
+class MemoryBackend::MemoryWindow : public TerminalWindow
+{
+public:
+    MemoryWindow (MemoryBackend &backendInit, int xInit, int yInit, int widthInit, int heightInit)
+        : backend (backendInit),
+          id (backend.nextWindowId++),
+          x (xInit), y (yInit),
+          width (std::max (widthInit, 1)), height (std::max (heightInit, 1)),
+          hidden (false),
+          cells (width * height, blankCell),
+          cursorX (0), cursorY (0),
+          attributes (A_NORMAL), colourPair (0)
+    {
+        backend.stack.push_back (this);
+        backend.recordOperation (Operation::createWindow, id, x, y, width * height);
+    }
+
+    ~MemoryWindow() override
+    {
+        backend.removeFromStack (this);
+        backend.recordOperation (Operation::destroyWindow, id);
+    }
+
+    int getX() const override
+    {
+        return x;
+    }
+
+    int getY() const override
+    {
+        return y;
+    }
+
+    int getWidth() const override
+    {
+        return width;
+    }
+
+    int getHeight() const override
+    {
+        return height;
+    }
+
+    void move (int newX, int newY) override
+    {
+        x = newX;
+        y = newY;
+        backend.recordOperation (Operation::moveWindow, id, x, y);
+    }
+
+    void setBounds (int newX, int newY, int newWidth, int newHeight) override
+    {
+        newWidth = std::max (newWidth, 1);
+        newHeight = std::max (newHeight, 1);
+
+        std::vector <Cell> newCells (newWidth * newHeight, blankCell);
+
+        for (int row = 0; row < std::min (height, newHeight); ++row)
+        {
+            std::copy (cells.begin() + row * width, cells.begin() + row * width + std::min (width, newWidth),
+                       newCells.begin() + row * newWidth);
+        }
+
+        cells.swap (newCells);
+        x = newX;
+        y = newY;
+        width = newWidth;
+        height = newHeight;
+        cursorX = std::min (cursorX, width - 1);
+        cursorY = std::min (cursorY, height - 1);
+
+        backend.recordOperation (Operation::resizeWindow, id, x, y, width * height);
+    }
+
+    void hide() override
+    {
+        if (! hidden)
+        {
+            hidden = true;
+            backend.removeFromStack (this);
+        }
+
+        backend.recordOperation (Operation::hideWindow, id);
+    }
+
+    void show() override
+    {
+        hidden = false;
+        backend.removeFromStack (this);
+        backend.stack.push_back (this);
+        backend.recordOperation (Operation::showWindow, id);
+    }
+
+    bool isHidden() const override
+    {
+        return hidden;
+    }
+
+    const TerminalWindow* getWindowAbove() const override
+    {
+        auto found = std::find (backend.stack.begin(), backend.stack.end(), this);
+
+        if (found == backend.stack.end() || found + 1 == backend.stack.end())
+        {
+            return nullptr;
+        }
+
+        return *(found + 1);
+    }
+
+    void setAttributes (attr_t newAttributes, short newColourPair) override
+    {
+        attributes = newAttributes & ~A_COLOR;
+        colourPair = newColourPair;
+        backend.recordOperation (Operation::setAttributes, id);
+    }
+
+    void moveCursor (int newX, int newY) override
+    {
+        backend.recordOperation (Operation::moveCursor, id, newX, newY);
+        placeCursor (newX, newY);
+    }
+
+    int getCursorX() const override
+    {
+        return cursorX;
+    }
+
+    int getCursorY() const override
+    {
+        return cursorY;
+    }
+
+    void addCharacter (const chtype character) override
+    {
+        backend.recordOperation (Operation::addCharacter, id, cursorX, cursorY, 1);
+        putCharacter (character);
+    }
+
+    void addCharacter (const chtype character, int newX, int newY) override
+    {
+        backend.recordOperation (Operation::addCharacter, id, newX, newY, 1);
+
+        if (placeCursor (newX, newY))
+        {
+            putCharacter (character);
+        }
+    }
+
+    void addString (const char *string, int length) override
+    {
+        backend.recordOperation (Operation::addString, id, cursorX, cursorY, length);
+        putString (string, length);
+    }
+
+    void addString (const char *string, int length, int newX, int newY) override
+    {
+        backend.recordOperation (Operation::addString, id, newX, newY, length);
+
+        if (placeCursor (newX, newY))
+        {
+            putString (string, length);
+        }
+    }
+
+    void setCells (const chtype *characters, int length, int cellX, int cellY) override
+    {
+        backend.recordOperation (Operation::setCells, id, cellX, cellY, length);
+
+        if (! placeCursor (cellX, cellY))
+        {
+            return;
+        }
+
+        int count = std::min (length, width - cellX);
+
+        for (int i = 0; i < count && (characters [i] & A_CHARTEXT) != 0; ++i)
+        {
+            storeCell (cellX + i, cellY, unpack (characters [i]));
+        }
+    }
+
+    void setWideCells (const cchar_t *characters, int length, int cellX, int cellY) override
+    {
+        backend.recordOperation (Operation::setWideCells, id, cellX, cellY, length);
+
+        if (! placeCursor (cellX, cellY))
+        {
+            return;
+        }
+
+        for (int i = 0; i < length && cellX < width; ++i)
+        {
+            wchar_t text [CCHARW_MAX + 1];
+            attr_t characterAttributes;
+            short characterPair;
+            getcchar (&characters [i], text, &characterAttributes, &characterPair, nullptr);
+
+            int characterWidth = std::max (wcwidth (text [0]), 1);
+
+            if (cellX + characterWidth > width)
+            {
+                break;
+            }
+
+            Cell cell {text [0], characterAttributes & ~A_COLOR, characterPair};
+
+            for (int mark = 1; mark < CCHARW_MAX && text [mark - 1] != L'\0'; ++mark)
+            {
+                cell.combiningMarks [mark - 1] = text [mark];
+            }
+
+            storeCell (cellX, cellY, cell);
+
+            if (characterWidth > 1)
+            {
+                storeCell (cellX + 1, cellY, Cell {0, characterAttributes & ~A_COLOR, characterPair});
+            }
+
+            cellX += characterWidth;
+        }
+    }
+
+    void drawHorizontalLine (const chtype character, int lineX, int lineY, int length) override
+    {
+        backend.recordOperation (Operation::drawLine, id, lineX, lineY, length);
+
+        if (! placeCursor (lineX, lineY))
+        {
+            return;
+        }
+
+        Cell cell = render (character != 0 ? character : ACS_HLINE);
+        int end = std::min (lineX + length, width);
+
+        for (int column = lineX; column < end; ++column)
+        {
+            storeCell (column, lineY, cell);
+        }
+    }
+
+    void drawVerticalLine (const chtype character, int lineX, int lineY, int length) override
+    {
+        backend.recordOperation (Operation::drawLine, id, lineX, lineY, length);
+
+        if (! placeCursor (lineX, lineY))
+        {
+            return;
+        }
+
+        Cell cell = render (character != 0 ? character : ACS_VLINE);
+        int end = std::min (lineY + length, height);
+
+        for (int row = lineY; row < end; ++row)
+        {
+            storeCell (lineX, row, cell);
+        }
+    }
+
+    void erase() override
+    {
+        backend.recordOperation (Operation::erase, id, 0, 0, width * height);
+        std::fill (cells.begin(), cells.end(), blankCell);
+        backend.cellsWritten += width * height;
+        cursorX = 0;
+        cursorY = 0;
+    }
+
+    /** Copy the window onto the screen. */
+    void compose (std::vector <Cell> &screen, int screenWidth, int screenHeight) const
+    {
+        int left = std::max (x, 0);
+        int right = std::min (x + width, screenWidth);
+
+        for (int row = std::max (y, 0); row < std::min (y + height, screenHeight); ++row)
+        {
+            for (int column = left; column < right; ++column)
+            {
+                screen [row * screenWidth + column] = cells [(row - y) * width + column - x];
+            }
+        }
+    }
+
+private:
+    MemoryBackend &backend;
+    int id;
+    int x, y;
+    int width, height;
+    bool hidden;
+
+    std::vector <Cell> cells;
+    int cursorX, cursorY;
+    attr_t attributes;
+    short colourPair;
+
+    bool placeCursor (int newX, int newY)
+    {
+        if (newX < 0 || newX >= width || newY < 0 || newY >= height)
+        {
+            return false;
+        }
+
+        cursorX = newX;
+        cursorY = newY;
+        return true;
+    }
+
+    static Cell unpack (const chtype character)
+    {
+        return Cell {static_cast <wchar_t> (character & A_CHARTEXT),
+                     character & (A_ATTRIBUTES & ~A_COLOR),
+                     static_cast <short> (PAIR_NUMBER (character))};
+    }
+
+    /** Merge the window's attributes into a character, as waddch does. */
+    Cell render (const chtype character) const
+    {
+        Cell cell = unpack (character);
+        cell.attributes |= attributes;
+
+        if (cell.colourPair == 0)
+        {
+            cell.colourPair = colourPair;
+        }
+
+        return cell;
+    }
+
+    /** Set a cell, blanking the other half of any two column character it cuts in two. */
+    void storeCell (int cellX, int cellY, const Cell &cell)
+    {
+        Cell *row = cells.data() + cellY * width;
+
+        if (row [cellX].character == 0 && cellX > 0)
+        {
+            row [cellX - 1].character = L' ';
+        }
+
+        if (cell.character != 0 && cellX + 1 < width && row [cellX + 1].character == 0)
+        {
+            row [cellX + 1].character = L' ';
+        }
+
+        row [cellX] = cell;
+        ++backend.cellsWritten;
+    }
+
+    /** Write a character at the cursor and advance it. As with waddch on a window which
+     *  does not scroll, a character written in the bottom right cell leaves the cursor
+     *  there and returns false.
+     */
+    bool putCharacter (const chtype character)
+    {
+        storeCell (cursorX, cursorY, render (character));
+
+        if (++cursorX >= width)
+        {
+            if (cursorY + 1 >= height)
+            {
+                cursorX = width - 1;
+                return false;
+            }
+
+            cursorX = 0;
+            ++cursorY;
+        }
+
+        return true;
+    }
+
+    /** Write a string at the cursor, stopping where putCharacter fails, as waddnstr does. */
+    void putString (const char *string, int length)
+    {
+        for (int i = 0; (length < 0 || i < length) && string [i] != '\0'; ++i)
+        {
+            if (! putCharacter (static_cast <unsigned char> (string [i])))
+            {
+                return;
+            }
+        }
+    }
+};
+
+bool MemoryBackend::Cell::operator== (const Cell &other) const
+{
+    return character == other.character && attributes == other.attributes && colourPair == other.colourPair
+           && std::equal (std::begin (combiningMarks), std::end (combiningMarks), std::begin (other.combiningMarks));
+}
+
+bool MemoryBackend::Cell::operator!= (const Cell &other) const
+{
+    return ! (*this == other);
+}
+
+MemoryBackend::MemoryBackend (int widthInit, int heightInit, int numColoursInit, int numColourPairsInit)
+    : width (std::max (widthInit, 1)), height (std::max (heightInit, 1)),
+      terminalWidth (width), terminalHeight (height),
+      numColours (numColoursInit),
+      colourPairs (std::max (numColourPairsInit, 0), PairColours {0, 0, false}),
+      screen (width * height, blankCell),
+      nextWindowId (1),
+      cellsWritten (0),
+      recordingOperations (false)
+{
+    resetOperationCounts();
+
+    // ncurses only fills in the line drawing characters when it starts up, so they are
+    // given their usual VT100 letters here.
+    for (const char *letter = lineDrawingLetters; *letter != '\0'; ++letter)
+    {
+        chtype &character = acs_map [static_cast <unsigned char> (*letter)];
+
+        if (character == 0)
+        {
+            character = static_cast <unsigned char> (*letter) | A_ALTCHARSET;
+        }
+    }
+}
+
+MemoryBackend::~MemoryBackend()
+{
+}
+
+MemoryBackend::Cell MemoryBackend::getCell (int x, int y) const
+{
+    if (x < 0 || x >= width || y < 0 || y >= height)
+    {
+        return blankCell;
+    }
+
+    return screen [y * width + x];
+}
+
+std::string MemoryBackend::getRowText (int y) const
+{
+    std::string text;
+
+    for (int x = 0; x < width; ++x)
+    {
+        Cell cell = getCell (x, y);
+
+        if (cell.character != 0)
+        {
+            appendUtf8 (text, cell.character);
+        }
+
+        for (int mark = 0; mark < CCHARW_MAX - 1 && cell.combiningMarks [mark] != L'\0'; ++mark)
+        {
+            appendUtf8 (text, cell.combiningMarks [mark]);
+        }
+    }
+
+    return text;
+}
+
+long MemoryBackend::getOperationCount (Operation operation) const
+{
+    return operationCounts [static_cast <int> (operation)];
+}
+
+long MemoryBackend::getCellsWritten() const
+{
+    return cellsWritten;
+}
+
+void MemoryBackend::resetOperationCounts()
+{
+    std::fill (std::begin (operationCounts), std::end (operationCounts), 0);
+    cellsWritten = 0;
+}
+
+void MemoryBackend::setRecordingOperations (bool shouldRecord)
+{
+    recordingOperations = shouldRecord;
+}
+
+const std::vector <MemoryBackend::OperationRecord>& MemoryBackend::getOperations() const
+{
+    return operations;
+}
+
+void MemoryBackend::clearOperations()
+{
+    operations.clear();
+}
+
+bool MemoryBackend::getColourPairColours (short pair, short &foregroundColour, short &backgroundColour) const
+{
+    if (pair < 0 || pair >= static_cast <int> (colourPairs.size()) || ! colourPairs [pair].initialised)
+    {
+        return false;
+    }
+
+    foregroundColour = colourPairs [pair].foregroundColour;
+    backgroundColour = colourPairs [pair].backgroundColour;
+    return true;
+}
+
+void MemoryBackend::pushKey (int key)
+{
+    keys.push_back (key);
+}
+
+void MemoryBackend::setTerminalSize (int newWidth, int newHeight)
+{
+    terminalWidth = std::max (newWidth, 1);
+    terminalHeight = std::max (newHeight, 1);
+}
+
+int MemoryBackend::getScreenWidth() const
+{
+    return width;
+}
+
+int MemoryBackend::getScreenHeight() const
+{
+    return height;
+}
+
+bool MemoryBackend::updateScreenSize()
+{
+    if (terminalWidth == width && terminalHeight == height)
+    {
+        return false;
+    }
+
+    width = terminalWidth;
+    height = terminalHeight;
+    screen.assign (width * height, blankCell);
+    return true;
+}
+
+int MemoryBackend::getNumColours() const
+{
+    return numColours;
+}
+
+int MemoryBackend::getNumColourPairs() const
+{
+    return static_cast <int> (colourPairs.size());
+}
+
+void MemoryBackend::initialiseColourPair (short pair, short foregroundColour, short backgroundColour)
+{
+    recordOperation (Operation::initialiseColourPair, 0, pair);
+
+    if (pair > 0 && pair < static_cast <int> (colourPairs.size()))
+    {
+        colourPairs [pair] = PairColours {foregroundColour, backgroundColour, true};
+    }
+}
+
+void MemoryBackend::setCursorVisibility (int)
+{
+}
+
+void MemoryBackend::refresh()
+{
+    recordOperation (Operation::refresh, 0);
+    std::fill (screen.begin(), screen.end(), blankCell);
+
+    for (const MemoryWindow *window : stack)
+    {
+        window->compose (screen, width, height);
+    }
+}
+
+int MemoryBackend::readKey()
+{
+    if (keys.empty())
+    {
+        return ERR;
+    }
+
+    int key = keys.front();
+    keys.pop_front();
+    return key;
+}
+
+std::unique_ptr <TerminalWindow> MemoryBackend::createWindow (int x, int y, int windowWidth, int windowHeight)
+{
+    return std::unique_ptr <TerminalWindow> (new MemoryWindow (*this, x, y, windowWidth, windowHeight));
+}
+
+void MemoryBackend::recordOperation (Operation operation, int windowId, int x, int y, int length)
+{
+    ++operationCounts [static_cast <int> (operation)];
+
+    if (recordingOperations)
+    {
+        operations.push_back (OperationRecord {operation, windowId, x, y, length});
+    }
+}
+
+void MemoryBackend::removeFromStack (const MemoryWindow *window)
+{
+    stack.erase (std::remove (stack.begin(), stack.end(), window), stack.end());
+}
@@ -0,0 +1,180 @@
+#ifndef MEMORY_BACKEND_HPP_INCLUDED
+#define MEMORY_BACKEND_HPP_INCLUDED
+
+#include <deque>
+#include <string>
+#include <vector>
+#include "TerminalBackend.hpp"
+
+/** A backend which keeps the screen in memory instead of drawing on a terminal.
+ *
+ *  Windows are stacked and drawn on as ncurses would, and refresh() composes them into a
+ *  grid of cells which can be inspected. Every call made to the backend is counted, and can
+ *  also be logged, so tests and benchmarks can check both what was drawn and how much work
+ *  it took, with no terminal and no I/O.
+ *
+ *  Control characters are stored as they are rather than moving the cursor.
+ *
+ *  Install it with Curses::setBackend() before Curses is first used.
+ */
+class MemoryBackend : public TerminalBackend
+{
+public:
+    /** Constructor
+     *
+     *  @param widthInit the width of the screen
+     *  @param heightInit the height of the screen
+     *  @param numColoursInit the number of colours to offer
+     *  @param numColourPairsInit the number of colour pairs to offer, including pair 0
+     */
+    MemoryBackend (int widthInit, int heightInit, int numColoursInit = 8, int numColourPairsInit = 256);
+    /** Destructor */
+    ~MemoryBackend() override;
+
+    /** A cell of the screen. */
+    struct Cell
+    {
+        /** The character, or the letter of a line drawing character, or 0 for the right
+         *  half of a two column character.
+         */
+        wchar_t character;
+        attr_t attributes; /**< The attributes, without the colour pair. */
+        short colourPair; /**< The colour pair. */
+        /** The combining marks shown with the character, padded with nulls. */
+        wchar_t combiningMarks [CCHARW_MAX - 1];
+
+        bool operator== (const Cell &other) const;
+        bool operator!= (const Cell &other) const;
+    };
+
+    /** The kinds of call made to the backend. */
+    enum class Operation
+    {
+        createWindow, /**< A window was created. */
+        destroyWindow, /**< A window was destroyed. */
+        moveWindow, /**< A window was moved. */
+        resizeWindow, /**< A window was moved and resized. */
+        hideWindow, /**< A window was hidden. */
+        showWindow, /**< A window was shown. */
+        setAttributes, /**< A window's attributes were set. */
+        moveCursor, /**< A window's cursor was moved. */
+        addCharacter, /**< A character was added, like waddch. */
+        addString, /**< A string was added, like waddnstr. */
+        setCells, /**< A row of characters was copied, like waddchnstr. */
+        setWideCells, /**< A row of wide characters was copied, like wadd_wchnstr. */
+        drawLine, /**< A horizontal or vertical line was drawn. */
+        erase, /**< A window was erased. */
+        initialiseColourPair, /**< A colour pair was set up. */
+        refresh, /**< The screen was refreshed. */
+        numOperations /**< The number of kinds of operation. */
+    };
+
+    /** A logged call to the backend. */
+    struct OperationRecord
+    {
+        Operation operation; /**< The kind of call. */
+        int windowId; /**< The window it was made on, numbered from 1 in order of creation, or 0. */
+        int x, y; /**< The position it was made at, if it has one. */
+        int length; /**< The number of cells or characters it covered, if it has one. */
+    };
+
+    /** Returns a cell of the screen as it was at the last refresh. Cells outside the screen
+     *  are returned as blanks.
+     *
+     *  @param x the x position of the cell
+     *  @param y the y position of the cell
+     */
+    Cell getCell (int x, int y) const;
+    /** Returns a row of the screen as it was at the last refresh, as UTF-8. Line drawing
+     *  characters are given as their letters, and combining marks follow their characters.
+     *
+     *  @param y the row to return
+     */
+    std::string getRowText (int y) const;
+
+    /** Returns the number of calls of a kind made since the counts were last reset. */
+    long getOperationCount (Operation operation) const;
+    /** Returns the number of cells written by drawing calls since the counts were last reset. */
+    long getCellsWritten() const;
+    /** Set all the counts back to zero. */
+    void resetOperationCounts();
+
+    /** Set whether each call is logged as well as counted. Logging is off to begin with.
+     *
+     *  @param shouldRecord whether to log calls
+     */
+    void setRecordingOperations (bool shouldRecord);
+    /** Returns the calls logged since the log was last cleared. */
+    const std::vector <OperationRecord>& getOperations() const;
+    /** Empty the log of calls. */
+    void clearOperations();
+
+    /** Returns the colours a pair was set up with. Returns false if the pair was never set up.
+     *
+     *  @param pair the pair
+     *  @param foregroundColour set to the foreground colour
+     *  @param backgroundColour set to the background colour
+     */
+    bool getColourPairColours (short pair, short &foregroundColour, short &backgroundColour) const;
+
+    /** Queue a key to be returned by readKey().
+     *
+     *  @param key the key code
+     */
+    void pushKey (int key);
+    /** Change the size the terminal reports, as if it had been resized. The screen takes
+     *  the new size at the next call to updateScreenSize().
+     *
+     *  @param newWidth the new width
+     *  @param newHeight the new height
+     */
+    void setTerminalSize (int newWidth, int newHeight);
+
+    int getScreenWidth() const override;
+    int getScreenHeight() const override;
+    bool updateScreenSize() override;
+
+    int getNumColours() const override;
+    int getNumColourPairs() const override;
+    void initialiseColourPair (short pair, short foregroundColour, short backgroundColour) override;
+
+    void setCursorVisibility (int visibility) override;
+    void refresh() override;
+    int readKey() override;
+
+    std::unique_ptr <TerminalWindow> createWindow (int x, int y, int width, int height) override;
+
+private:
+    MemoryBackend (const MemoryBackend&) = delete;
+    MemoryBackend& operator= (const MemoryBackend&) = delete;
+
+    class MemoryWindow;
+
+    struct PairColours
+    {
+        short foregroundColour, backgroundColour;
+        bool initialised;
+    };
+
+    int width, height;
+    int terminalWidth, terminalHeight;
+    int numColours;
+    std::vector <PairColours> colourPairs;
+
+    std::vector <Cell> screen;
+    /** The windows being shown, from the bottom of the stack to the top. */
+    std::vector <MemoryWindow*> stack;
+    int nextWindowId;
+
+    std::deque <int> keys;
+
+    long operationCounts [static_cast <int> (Operation::numOperations)];
+    long cellsWritten;
+    bool recordingOperations;
+    std::vector <OperationRecord> operations;
+
+    void recordOperation (Operation operation, int windowId, int x = 0, int y = 0, int length = 0);
+    void removeFromStack (const MemoryWindow *window);
+};
+
+#endif // MEMORY_BACKEND_HPP_INCLUDED
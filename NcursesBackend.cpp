@@ -0,0 +1,227 @@
+#include "NcursesBackend.hpp"
+#include <algorithm>
+#include <panel.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace
+{
+    using WindowPointer = std::unique_ptr <WINDOW, int(*)(WINDOW*)>;
+    using PanelPointer = std::unique_ptr <PANEL, int(*)(PANEL*)>;
+
+    /** An ncurses window in a panel. */
+    class NcursesWindow : public TerminalWindow
+    {
+    public:
+        NcursesWindow (int x, int y, int width, int height)
+            : window (newwin (height, width, y, x), delwin),
+              panel (new_panel (window.get()), del_panel)
+        {
+            set_panel_userptr (panel.get(), this);
+        }
+
+        int getX() const override
+        {
+            return getbegx (window.get());
+        }
+
+        int getY() const override
+        {
+            return getbegy (window.get());
+        }
+
+        int getWidth() const override
+        {
+            return getmaxx (window.get());
+        }
+
+        int getHeight() const override
+        {
+            return getmaxy (window.get());
+        }
+
+        void move (int x, int y) override
+        {
+            move_panel (panel.get(), y, x);
+        }
+
+        void setBounds (int x, int y, int width, int height) override
+        {
+            // Shrink before moving and grow afterwards, so the window never has to extend
+            // past the edge of the screen, where move_panel would fail.
+            wresize (window.get(), std::min (height, getHeight()), std::min (width, getWidth()));
+            move_panel (panel.get(), y, x);
+            wresize (window.get(), height, width);
+        }
+
+        void hide() override
+        {
+            hide_panel (panel.get());
+        }
+
+        void show() override
+        {
+            show_panel (panel.get());
+        }
+
+        bool isHidden() const override
+        {
+            return panel_hidden (panel.get()) == TRUE;
+        }
+
+        const TerminalWindow* getWindowAbove() const override
+        {
+            PANEL *above = panel_above (panel.get());
+            return above != nullptr ? static_cast <const TerminalWindow*> (panel_userptr (above)) : nullptr;
+        }
+
+        void setAttributes (attr_t attributes, short colourPair) override
+        {
+            wattr_set (window.get(), attributes, colourPair, nullptr);
+        }
+
+        void moveCursor (int x, int y) override
+        {
+            wmove (window.get(), y, x);
+        }
+
+        int getCursorX() const override
+        {
+            return getcurx (window.get());
+        }
+
+        int getCursorY() const override
+        {
+            return getcury (window.get());
+        }
+
+        void addCharacter (const chtype character) override
+        {
+            waddch (window.get(), character);
+        }
+
+        void addCharacter (const chtype character, int x, int y) override
+        {
+            mvwaddch (window.get(), y, x, character);
+        }
+
+        void addString (const char *string, int length) override
+        {
+            waddnstr (window.get(), string, length);
+        }
+
+        void addString (const char *string, int length, int x, int y) override
+        {
+            mvwaddnstr (window.get(), y, x, string, length);
+        }
+
+        void setCells (const chtype *characters, int length, int x, int y) override
+        {
+            mvwaddchnstr (window.get(), y, x, characters, length);
+        }
+
+        void setWideCells (const cchar_t *characters, int length, int x, int y) override
+        {
+            mvwadd_wchnstr (window.get(), y, x, characters, length);
+        }
+
+        void drawHorizontalLine (const chtype character, int x, int y, int length) override
+        {
+            mvwhline (window.get(), y, x, character, length);
+        }
+
+        void drawVerticalLine (const chtype character, int x, int y, int length) override
+        {
+            mvwvline (window.get(), y, x, character, length);
+        }
+
+        void erase() override
+        {
+            werase (window.get());
+        }
+
+    private:
+        // The panel is destroyed first, as it refers to the window.
+        WindowPointer window;
+        PanelPointer panel;
+    };
+}
+
+NcursesBackend::NcursesBackend()
+{
+    initscr();
+    keypad (stdscr, true);
+    nodelay (stdscr, true);
+    cbreak();
+    noecho();
+    start_color();
+}
+
+NcursesBackend::~NcursesBackend()
+{
+    endwin();
+}
+
+int NcursesBackend::getScreenWidth() const
+{
+    return COLS;
+}
+
+int NcursesBackend::getScreenHeight() const
+{
+    return LINES;
+}
+
+bool NcursesBackend::updateScreenSize()
+{
+    winsize size {};
+
+    if (ioctl (STDOUT_FILENO, TIOCGWINSZ, &size) < 0 || size.ws_row == 0 || size.ws_col == 0)
+    {
+        return false;
+    }
+
+    if (size.ws_row == LINES && size.ws_col == COLS)
+    {
+        return false;
+    }
+
+    resizeterm (size.ws_row, size.ws_col);
+    return true;
+}
+
+int NcursesBackend::getNumColours() const
+{
+    return COLORS;
+}
+
+int NcursesBackend::getNumColourPairs() const
+{
+    return has_colors() ? COLOR_PAIRS : 0;
+}
+
+void NcursesBackend::initialiseColourPair (short pair, short foregroundColour, short backgroundColour)
+{
+    init_pair (pair, foregroundColour, backgroundColour);
+}
+
+void NcursesBackend::setCursorVisibility (int visibility)
+{
+    curs_set (visibility);
+}
+
+void NcursesBackend::refresh()
+{
+    update_panels();
+    doupdate();
+}
+
+int NcursesBackend::readKey()
+{
+    return getch();
+}
+
+std::unique_ptr <TerminalWindow> NcursesBackend::createWindow (int x, int y, int width, int height)
+{
+    return std::unique_ptr <TerminalWindow> (new NcursesWindow (x, y, width, height));
+}
@@ -0,0 +1,38 @@
+#ifndef NCURSES_BACKEND_HPP_INCLUDED
+#define NCURSES_BACKEND_HPP_INCLUDED
+
+#include "TerminalBackend.hpp"
+
+/** A backend which draws on the terminal with ncurses and its panel library.
+ *
+ *  The screen is set up when the backend is created and restored when it is destroyed, so
+ *  only one may exist at a time.
+ */
+class NcursesBackend : public TerminalBackend
+{
+public:
+    /** Constructor */
+    NcursesBackend();
+    /** Destructor */
+    ~NcursesBackend() override;
+
+    int getScreenWidth() const override;
+    int getScreenHeight() const override;
+    bool updateScreenSize() override;
+
+    int getNumColours() const override;
+    int getNumColourPairs() const override;
+    void initialiseColourPair (short pair, short foregroundColour, short backgroundColour) override;
+
+    void setCursorVisibility (int visibility) override;
+    void refresh() override;
+    int readKey() override;
+
+    std::unique_ptr <TerminalWindow> createWindow (int x, int y, int width, int height) override;
+
+private:
+    NcursesBackend (const NcursesBackend&) = delete;
+    NcursesBackend& operator= (const NcursesBackend&) = delete;
+};
+
+#endif // NCURSES_BACKEND_HPP_INCLUDED
@@ -0,0 +1,151 @@
+#include "NumberFormat.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    const int maxFastPrecision = 9;
+    const double powersOfTen [maxFastPrecision + 1] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+
+    /** Scaled values below this are exact enough in a double to round by hand. */
+    const double maxFastScaledValue = 4294967296.0;
+    /** How close to a half the fraction may come before rounding is left to snprintf.
+     *  Below maxFastScaledValue the scaled value is never further than this out.
+     */
+    const double halfwayTolerance = 1e-6;
+
+    /** Write the digits of a number ending just before end, returning where they start. */
+    char* writeDigitsBackwards (unsigned long long value, char *end)
+    {
+        do
+        {
+            *--end = static_cast <char> ('0' + value % 10);
+            value /= 10;
+        }
+        while (value != 0);
+
+        return end;
+    }
+
+    int formatFixed (double value, int precision, char *buffer)
+    {
+        if (precision <= maxFastPrecision && std::isfinite (value))
+        {
+            double scaled = std::fabs (value) * powersOfTen [precision];
+
+            if (scaled < maxFastScaledValue)
+            {
+                double whole = std::floor (scaled);
+                double fraction = scaled - whole;
+
+                if (std::fabs (fraction - 0.5) > halfwayTolerance)
+                {
+                    unsigned long long digits = static_cast <unsigned long long> (whole) + (fraction > 0.5 ? 1 : 0);
+                    unsigned long long divisor = static_cast <unsigned long long> (powersOfTen [precision]);
+
+                    // The fraction is written first, backwards from the end of a scratch
+                    // area, then the whole part in front of it.
+                    char scratch [32];
+                    char *end = scratch + sizeof (scratch);
+                    char *start = end;
+
+                    if (precision > 0)
+                    {
+                        unsigned long long fractionDigits = digits % divisor;
+
+                        for (int i = 0; i < precision; ++i)
+                        {
+                            *--start = static_cast <char> ('0' + fractionDigits % 10);
+                            fractionDigits /= 10;
+                        }
+
+                        *--start = '.';
+                    }
+
+                    start = writeDigitsBackwards (digits / divisor, start);
+
+                    // printf keeps the sign of negative numbers which round to zero.
+                    if (std::signbit (value))
+                    {
+                        *--start = '-';
+                    }
+
+                    int length = static_cast <int> (end - start);
+                    std::memcpy (buffer, start, length);
+                    return length;
+                }
+            }
+        }
+
+        int length = std::snprintf (buffer, NumberFormat::bufferSize, "%.*f", precision, value);
+        return std::min (length, NumberFormat::bufferSize - 1);
+    }
+}
+
+const int NumberFormat::maxPrecision;
+const int NumberFormat::bufferSize;
+
+NumberFormat::NumberFormat (int precisionInit, int widthInit, int maxWidthInit)
+    : precision (precisionInit),
+      width (widthInit),
+      maxWidth (maxWidthInit)
+{
+}
+
+int NumberFormat::formatDouble (double value, char *buffer) const
+{
+    int digits = std::max (std::min (precision, maxPrecision), 0);
+    int length = formatFixed (value, digits, buffer);
+
+    while (maxWidth > 0 && length > maxWidth && digits > 0)
+    {
+        length = formatFixed (value, --digits, buffer);
+    }
+
+    return finish (buffer, length);
+}
+
+int NumberFormat::formatInteger (long long value, char *buffer) const
+{
+    char scratch [32];
+    char *end = scratch + sizeof (scratch);
+
+    // Negating as unsigned copes with the most negative value.
+    unsigned long long magnitude = value < 0 ? 0ULL - static_cast <unsigned long long> (value)
+                                             : static_cast <unsigned long long> (value);
+    char *start = writeDigitsBackwards (magnitude, end);
+
+    if (value < 0)
+    {
+        *--start = '-';
+    }
+
+    int length = static_cast <int> (end - start);
+    std::memcpy (buffer, start, length);
+
+    return finish (buffer, length);
+}
+
+int NumberFormat::finish (char *buffer, int length) const
+{
+    int limit = maxWidth > 0 ? std::min (maxWidth, bufferSize - 1) : bufferSize - 1;
+
+    if (length > limit)
+    {
+        std::fill (buffer, buffer + limit, '#');
+        return limit;
+    }
+
+    int paddedLength = std::min (std::max (width, length), limit);
+
+    if (paddedLength > length)
+    {
+        int padding = paddedLength - length;
+        std::memmove (buffer + padding, buffer, length);
+        std::fill (buffer, buffer + padding, ' ');
+    }
+
+    return paddedLength;
+}
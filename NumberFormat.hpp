@@ -0,0 +1,54 @@
+#ifndef NUMBER_FORMAT_HPP_INCLUDED
+#define NUMBER_FORMAT_HPP_INCLUDED
+
+/** How a number is laid out when it is printed.
+ *
+ *  Numbers are formatted into a caller's buffer without allocating. Most fixed point
+ *  values are converted with integer arithmetic, giving exactly what printf's "%.*f" would.
+ *  Values too large for that, and the rare values which lie too close to halfway between
+ *  two results to be sure which way to round, are passed on to snprintf.
+ */
+struct NumberFormat
+{
+    /** The most digits shown after the decimal point. */
+    static const int maxPrecision = 17;
+    /** The size of buffer the formatting functions need. */
+    static const int bufferSize = 352;
+
+    /** Constructor
+     *
+     *  @param precisionInit the number of digits after the decimal point
+     *  @param widthInit the least number of characters to use. Shorter numbers are padded
+     *                   on the left with spaces.
+     *  @param maxWidthInit the most characters to use, or 0 for no limit. Digits after the
+     *                      decimal point are dropped until the number fits, and a number
+     *                      which still does not fit is shown as hashes.
+     */
+    explicit NumberFormat (int precisionInit = 2, int widthInit = 0, int maxWidthInit = 0);
+
+    int precision; /**< The number of digits after the decimal point. */
+    int width; /**< The least number of characters to use. */
+    int maxWidth; /**< The most characters to use, or 0 for no limit. */
+
+    /** Format a floating point number.
+     *
+     *  Returns the number of characters written, which are not null terminated.
+     *
+     *  @param value the value to format
+     *  @param buffer where to write the text, which must hold bufferSize characters
+     */
+    int formatDouble (double value, char *buffer) const;
+    /** Format an integer. The precision is ignored.
+     *
+     *  Returns the number of characters written, which are not null terminated.
+     *
+     *  @param value the value to format
+     *  @param buffer where to write the text, which must hold bufferSize characters
+     */
+    int formatInteger (long long value, char *buffer) const;
+
+private:
+    int finish (char *buffer, int length) const;
+};
+
+#endif // NUMBER_FORMAT_HPP_INCLUDED
@@ -148,4 +148,147 @@ private:
     T bottomValue, topValue;
 };
 
+/** A range fixed at compile time, for use with StaticRangedValue.
+ *
+ *  Only integral types can be template arguments, so ranges of other types are given by
+ *  writing a traits struct with the same static members, for example
+ *
+ *      struct UnitRange
+ *      {
+ *          using ValueType = double;
+ *          static constexpr double bottomValue() {return 0.0;}
+ *          static constexpr double topValue() {return 1.0;}
+ *      };
+ */
+template <typename T, T bottom, T top>
+struct StaticRange
+{
+    /** The type of the range boundaries. */
+    using ValueType = T;
+
+    /** Returns the bottom end of the range. */
+    static constexpr T bottomValue()
+    {
+        return bottom;
+    }
+
+    /** Returns the top end of the range. */
+    static constexpr T topValue()
+    {
+        return top;
+    }
+};
+
+/** A value constricted to a range which is known at compile time.
+ *
+ *  This behaves like RangedValue, but the range comes from a traits type, so only the
+ *  value itself is stored and a StaticRangedValue is the same size as a T. Values are
+ *  clamped with std::min and std::max rather than branches, and everything is constexpr.
+ *
+ *  @see StaticRange for the requirements on RangeTraits
+ */
+template <typename T, typename RangeTraits>
+class StaticRangedValue
+{
+public:
+    /** Constructor
+     *
+     *  @param valueInit the initial value
+     */
+    constexpr explicit StaticRangedValue (T valueInit = getMinValue())
+        : value (clamp (valueInit))
+    {
+    }
+
+    /** Set the value.
+     *
+     *  @param rhs the new value
+     */
+    constexpr StaticRangedValue& operator= (T rhs)
+    {
+        value = clamp (rhs);
+        return *this;
+    }
+
+    /** Implicit cast to the underlying type. */
+    constexpr operator T() const
+    {
+        return value;
+    }
+
+    /** Increment the value.
+     *
+     *  @param rhs the value to increment by
+     */
+    constexpr StaticRangedValue& operator+= (const T &rhs)
+    {
+        return operator= (value + rhs);
+    }
+
+    /** Decrement the value.
+     *
+     *  @param rhs the value to decrement by
+     */
+    constexpr StaticRangedValue& operator-= (const T &rhs)
+    {
+        return operator= (value - rhs);
+    }
+
+    /** Compound multiplication assignment.
+     *
+     *  @param rhs the value to multiply by
+     */
+    constexpr StaticRangedValue& operator*= (const T &rhs)
+    {
+        return operator= (value * rhs);
+    }
+
+    /** Compound division assignment.
+     *
+     *  @param rhs the value to divide by
+     */
+    constexpr StaticRangedValue& operator/= (const T &rhs)
+    {
+        return operator= (value / rhs);
+    }
+
+    /** Returns the range. */
+    static constexpr T getRange()
+    {
+        return getTopValue() - getBottomValue();
+    }
+
+    /** Returns the lowest end of the range. */
+    static constexpr T getMinValue()
+    {
+        return std::min <T> (getBottomValue(), getTopValue());
+    }
+
+    /** Returns the highest end of the range. */
+    static constexpr T getMaxValue()
+    {
+        return std::max <T> (getBottomValue(), getTopValue());
+    }
+
+    /** Returns the bottom end of the range. */
+    static constexpr T getBottomValue()
+    {
+        return RangeTraits::bottomValue();
+    }
+
+    /** Returns the top end of the range. */
+    static constexpr T getTopValue()
+    {
+        return RangeTraits::topValue();
+    }
+
+private:
+    T value;
+
+    static constexpr T clamp (T newValue)
+    {
+        return std::min <T> (std::max <T> (newValue, getMinValue()), getMaxValue());
+    }
+};
+
 #endif // RANGED_VALUE_HPP_INCLUDED
@@ -0,0 +1,558 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Curses.hpp"
+#include "MemoryBackend.hpp"
+#include "RenderLoop.hpp"
+#include "RepaintManager.hpp"
+#include "Slider.hpp"
+#include "TimerService.hpp"
+
+/** Draws scenes through MemoryBackend, with no terminal, and checks the cells they leave
+ *  on the screen and the calls they take to draw. Every scene is drawn both directly and
+ *  through a canvas, and drawn again inside several clip regions, where it must give
+ *  exactly the same cells as unclipped inside the region and leave the rest blank.
+ *  Colour pairs are used up to check windows keep their colours when pairs are reused,
+ *  and timers and the render loop are started with edge case periods and a busy queue.
+ *
+ *  Build and run with "make check". Exits with 1 if any check fails.
+ */
+
+namespace
+{
+    const int screenWidth = 80;
+    const int screenHeight = 30;
+
+    /** The size of the window scenes are drawn in, at the top left of the screen. */
+    const int sceneWidth = 40;
+    const int sceneHeight = 16;
+
+    /** Few enough colour pairs that a scene can use them all up. */
+    const int numColourPairs = 9;
+
+    using Cells = std::vector <MemoryBackend::Cell>;
+    using Scene = std::function <void (Window::DrawSession&)>;
+
+    struct ClipRegion
+    {
+        int x, y, width, height;
+    };
+
+    /** Clip regions which cut scenes in the middle, at the edges and not at all. */
+    const ClipRegion clipRegions [] = {{3, 2, 20, 8}, {0, 0, 1, 1}, {17, 5, 50, 40},
+                                       {-5, -5, 12, 9}, {10, 0, 0, 5}, {39, 15, 1, 1}};
+
+    MemoryBackend *memory = nullptr;
+    int numFailures = 0;
+
+    void check (bool passed, const std::string &description)
+    {
+        std::printf ("%-4s %s\n", passed ? "ok" : "FAIL", description.c_str());
+
+        if (! passed)
+        {
+            ++numFailures;
+        }
+    }
+
+    Cells captureCells (int width, int height)
+    {
+        Curses::getInstance().refreshScreen();
+        Cells cells;
+
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                cells.push_back (memory->getCell (x, y));
+            }
+        }
+
+        return cells;
+    }
+
+    bool startsWith (const std::string &text, const std::string &start)
+    {
+        return text.compare (0, start.size(), start) == 0;
+    }
+
+    /** Returns one row of captured ASCII cells, with line drawing characters as their letters. */
+    std::string getRowText (const Cells &cells, int width, int y)
+    {
+        std::string text;
+
+        for (int x = 0; x < width; ++x)
+        {
+            text += static_cast <char> (cells [y * width + x].character);
+        }
+
+        return text;
+    }
+
+    /** Returns true if the first rows of captured cells start with some text. If not, the
+     *  rows are printed to show what was drawn instead.
+     */
+    bool hasRows (const Cells &cells, int width, const std::vector <std::string> &rows)
+    {
+        bool matched = true;
+
+        for (std::size_t y = 0; y < rows.size(); ++y)
+        {
+            matched = matched && startsWith (getRowText (cells, width, static_cast <int> (y)), rows [y]);
+        }
+
+        if (! matched)
+        {
+            for (std::size_t y = 0; y < rows.size(); ++y)
+            {
+                std::printf ("     \"%s\"\n", getRowText (cells, width, static_cast <int> (y)).c_str());
+            }
+        }
+
+        return matched;
+    }
+
+    /** Draw a scene in a new window and return the cells it leaves there. */
+    Cells drawScene (const Scene &scene, bool useCanvas, const ClipRegion *clip = nullptr)
+    {
+        Window window = Curses::getInstance().createWindow (0, 0, sceneWidth, sceneHeight);
+        window.setUseCanvas (useCanvas);
+
+        {
+            Window::DrawSession session (window);
+
+            if (clip != nullptr)
+            {
+                session.restrictClip (clip->x, clip->y, clip->width, clip->height);
+            }
+
+            scene (session);
+            session.commit();
+        }
+
+        return captureCells (sceneWidth, sceneHeight);
+    }
+
+    /** Check a scene comes out the same directly and through a canvas, and that each clip
+     *  region leaves exactly its part of the scene. Returns the unclipped cells.
+     */
+    Cells checkScene (const std::string &name, const Scene &scene)
+    {
+        Cells unclipped = drawScene (scene, false);
+        check (drawScene (scene, true) == unclipped, name + ": canvas matches direct drawing");
+
+        for (bool useCanvas : {false, true})
+        {
+            bool allMatched = true;
+
+            for (const ClipRegion &clip : clipRegions)
+            {
+                Cells clipped = drawScene (scene, useCanvas, &clip);
+
+                for (int y = 0; y < sceneHeight; ++y)
+                {
+                    for (int x = 0; x < sceneWidth; ++x)
+                    {
+                        bool inside = x >= clip.x && x < clip.x + clip.width
+                                      && y >= clip.y && y < clip.y + clip.height;
+                        MemoryBackend::Cell expected = inside ? unclipped [y * sceneWidth + x]
+                                                              : MemoryBackend::Cell {L' ', A_NORMAL, 0};
+
+                        allMatched = allMatched && clipped [y * sceneWidth + x] == expected;
+                    }
+                }
+            }
+
+            check (allMatched, name + (useCanvas ? ": clipped canvas cells match unclipped"
+                                                 : ": clipped cells match unclipped"));
+        }
+
+        return unclipped;
+    }
+
+    /** Returns the number of calls of a kind a scene makes when drawn directly. */
+    long countOperations (const Scene &scene, MemoryBackend::Operation operation)
+    {
+        Window window = Curses::getInstance().createWindow (0, 0, sceneWidth, sceneHeight);
+        memory->resetOperationCounts();
+
+        {
+            Window::DrawSession session (window);
+            scene (session);
+        }
+
+        return memory->getOperationCount (operation);
+    }
+
+    void checkLines()
+    {
+        Scene scene = [] (Window::DrawSession &session)
+                      {
+                          session.drawLine (1, 1, 30, 1, '-');
+                          session.drawLine (2, 2, 2, 12, '|');
+                          session.drawLine (4, 3, 20, 9, '\\');
+                          session.drawLine (36, 2, 25, 14, '/');
+                          session.drawLine (-10, 15, 50, 13, '=');
+                          session.drawLine (30, 20, 38, 4, '*');
+                      };
+
+        Cells cells = checkScene ("lines", scene);
+
+        check (hasRows (cells, sceneWidth, {"",
+                                            " ------------------------------",
+                                            "  |                                 /",
+                                            "  | \\\\                             /",
+                                            "  |   \\\\                          /   *",
+                                            "  |     \\\\\\                      /    *",
+                                            "  |        \\\\\\                  /    *",
+                                            "  |           \\\\               /     *"}),
+               "lines: cells");
+
+        check (countOperations ([] (Window::DrawSession &session) { session.drawLine (1, 1, 30, 1, '-'); },
+                                MemoryBackend::Operation::drawLine) == 1,
+               "lines: a horizontal line is drawn with one call");
+        check (countOperations ([] (Window::DrawSession &session) { session.drawLine (2, 2, 2, 12, '|'); },
+                                MemoryBackend::Operation::drawLine) == 1,
+               "lines: a vertical line is drawn with one call");
+    }
+
+    void checkEllipses()
+    {
+        Scene scene = [] (Window::DrawSession &session)
+                      {
+                          session.drawEllipse (1, 1, 15, 9, 'o');
+                          session.fillEllipse (18, 2, 13, 7, '#');
+                          session.drawEllipse (30, 8, 14, 12, '.');
+                          session.fillEllipse (-4, 11, 10, 6, '@');
+                      };
+
+        Cells cells = checkScene ("ellipses", scene);
+
+        check (hasRows (cells, sceneWidth, {"",
+                                            "     ooooooo",
+                                            "   oo       oo       #######",
+                                            "  o           o    ###########",
+                                            " o             o  #############",
+                                            " o             o  #############",
+                                            " o             o  #############",
+                                            "  o           o    ###########",
+                                            "   oo       oo       #######      ......"}),
+               "ellipses: cells");
+
+        check (countOperations ([] (Window::DrawSession &session) { session.fillEllipse (18, 2, 13, 7, '#'); },
+                                MemoryBackend::Operation::drawLine) == 7,
+               "ellipses: a filled ellipse is drawn with one call per row");
+    }
+
+    void checkBoxes()
+    {
+        Scene scene = [] (Window::DrawSession &session)
+                      {
+                          session.drawBox (0, 0, sceneWidth, sceneHeight);
+                          session.drawBox (2, 1, 10, 5);
+                          session.drawBox (8, 3, 3, 3);
+                          session.drawBox (30, 10, 20, 10);
+                          session.drawBox (5, 9, 1, 1);
+                      };
+
+        Cells cells = checkScene ("boxes", scene);
+
+        check (hasRows (cells, sceneWidth, {"lqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqk",
+                                            "x lqqqqqqqqk                           x",
+                                            "x x        x                           x",
+                                            "x x     lqkx                           x",
+                                            "x x     x xx                           x",
+                                            "x mqqqqqmqjj                           x"}),
+               "boxes: cells");
+
+        check (countOperations ([] (Window::DrawSession &session) { session.drawBox (2, 1, 10, 5); },
+                                MemoryBackend::Operation::drawLine) == 4,
+               "boxes: a box is drawn with one call per side");
+    }
+
+    void checkWideText()
+    {
+        Curses::Instance curses = Curses::getInstance();
+        Window window = curses.createWindow (0, 0, sceneWidth, sceneHeight);
+
+        for (bool useCanvas : {false, true})
+        {
+            window.setUseCanvas (useCanvas);
+            window.clear();
+            window.printString ("\xe6\x97\xa5\xe6\x9c\xac caf\xc3\xa9 e\xcc\x81", 0, 0);
+
+            {
+                Window::DrawSession session (window);
+                session.restrictClip (1, 1, 4, 1);
+                session.printString ("\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e", 0, 1);
+            }
+
+            window.commit();
+            curses.refreshScreen();
+
+            std::string mode = useCanvas ? " through a canvas" : "";
+            check (startsWith (memory->getRowText (0), "\xe6\x97\xa5\xe6\x9c\xac caf\xc3\xa9 e\xcc\x81 "),
+                   "wide text: two column characters and combining marks" + mode);
+            check (startsWith (memory->getRowText (1), "  \xe6\x9c\xac   "),
+                   "wide text: characters cut by the clip region leave blanks" + mode);
+        }
+
+        check (curses.getTextWidth ("\xe6\x97\xa5\xe6\x9c\xac caf\xc3\xa9 e\xcc\x81") == 11,
+               "wide text: width counts columns, not characters");
+    }
+
+    void checkWindowCorner()
+    {
+        Curses::Instance curses = Curses::getInstance();
+        Window window = curses.createWindow (0, 0, sceneWidth, sceneHeight);
+
+        for (bool useCanvas : {false, true})
+        {
+            window.setUseCanvas (useCanvas);
+            window.clear();
+            window.printString ("hello", sceneWidth - 2, sceneHeight - 1);
+            window.commit();
+            curses.refreshScreen();
+
+            check (memory->getRowText (sceneHeight - 1).compare (sceneWidth - 3, 4, " he ") == 0,
+                   useCanvas ? "corner: a canvas string stops at the bottom right cell"
+                             : "corner: a string stops at the bottom right cell");
+        }
+    }
+
+    class SliderBank : public Component
+    {
+    public:
+        void keyPressed (int) override
+        {
+        }
+
+    private:
+        void draw (Window::DrawSession&) override
+        {
+        }
+
+        void resized() override
+        {
+        }
+    };
+
+    void checkSliders()
+    {
+        RepaintManager &repaintManager = RepaintManager::getInstance();
+        SliderBank bank;
+        Slider sliders [2] = {{"Ham"}, {"Jam"}};
+
+        for (int s = 0; s < 2; ++s)
+        {
+            sliders [s].setLightweight (true);
+            bank.addChildComponent (sliders [s]);
+            sliders [s].setBounds (s * 10, 0, 10, 12);
+            sliders [s].setRange (0.0, 10.0);
+        }
+
+        bank.setBounds (0, 0, 20, 12);
+        sliders [0].setValue (3.0);
+        sliders [1].setValue (7.5);
+        repaintManager.paintDirtyComponents();
+
+        Cells cells = captureCells (20, 12);
+
+        check (hasRows (cells, 20, {"   lqk       lqk    ",
+                                    "   x x       x x    ",
+                                    "   x x       x x    ",
+                                    "   x x       x0x    ",
+                                    "   x x       x0x    ",
+                                    "   x x       x0x    ",
+                                    "   x x       x0x    ",
+                                    "   x0x       x0x    ",
+                                    "   x0x       x0x    ",
+                                    "   mqj       mqj    ",
+                                    "   3.00      7.50   ",
+                                    "   Ham       Jam    "}),
+               "sliders: cells");
+
+        memory->resetOperationCounts();
+        sliders [0].invalidate();
+        repaintManager.paintDirtyComponents();
+        check (memory->getCellsWritten() == 0, "sliders: repainting an unchanged slider writes no cells");
+
+        memory->resetOperationCounts();
+        sliders [0].setValue (4.0);
+        repaintManager.paintDirtyComponents();
+        check (memory->getCellsWritten() > 0 && memory->getCellsWritten() <= 12,
+               "sliders: a new value only writes the cells which changed");
+
+        Cells repainted = captureCells (20, 12);
+        bank.invalidate();
+        repaintManager.paintDirtyComponents();
+        check (captureCells (20, 12) == repainted, "sliders: repainting one slider matches repainting the bank");
+
+        check (! repaintManager.hasPendingWork(), "sliders: nothing is pending after a paint");
+        bank.invalidateLayout();
+        check (repaintManager.hasPendingWork(), "sliders: a layout alone is pending work");
+        repaintManager.paintDirtyComponents();
+
+        {
+            Window cover = Curses::getInstance().createWindow (0, 0, 5, 5);
+            check (repaintManager.hasPendingWork(), "sliders: a new panel is pending work");
+            repaintManager.paintDirtyComponents();
+        }
+
+        check (repaintManager.hasPendingWork(), "sliders: removing a panel is pending work");
+        repaintManager.paintDirtyComponents();
+    }
+
+    bool hasColours (const MemoryBackend::Cell &cell, Curses::Colour background, Curses::Colour foreground)
+    {
+        short foregroundNumber, backgroundNumber;
+
+        return memory->getColourPairColours (cell.colourPair, foregroundNumber, backgroundNumber)
+               && foregroundNumber == static_cast <short> (foreground)
+               && backgroundNumber == static_cast <short> (background);
+    }
+
+    void checkColourPairs()
+    {
+        Curses &curses = Curses::getInstance();
+        Window first = curses.createWindow (0, 0, 10, 1);
+        Window second = curses.createWindow (0, 1, 10, 1);
+        Window::VideoAttributes savedAttributes;
+
+        {
+            Window::DrawSession session (first);
+            session.setColours (Curses::Colour::blue, Curses::Colour::yellow);
+            session.printString ("a", 0, 0);
+            savedAttributes = session.getVideoAttributes();
+        }
+
+        long evictions = curses.getColourPairStatistics().evictions;
+
+        {
+            Window::DrawSession session (second);
+
+            for (int background = 0; background < curses.getNumColours(); ++background)
+            {
+                session.setColours (static_cast <Curses::Colour> (background), Curses::Colour::red);
+                session.printString ("b", background, 0);
+            }
+        }
+
+        check (curses.getColourPairStatistics().evictions > evictions, "colour pairs: pairs in use are reused");
+
+        first.printString ("c", 1, 0);
+        Cells cells = captureCells (2, 1);
+        check (hasColours (cells [1], Curses::Colour::blue, Curses::Colour::yellow),
+               "colour pairs: a window whose pair was reused keeps its colours");
+
+        {
+            Window::DrawSession session (second);
+
+            for (int background = 0; background < curses.getNumColours(); ++background)
+            {
+                session.setColours (static_cast <Curses::Colour> (background), Curses::Colour::green);
+            }
+
+            session.setVideoAttributes (savedAttributes);
+            session.printString ("d", 9, 0);
+        }
+
+        cells = captureCells (10, 2);
+        check (hasColours (cells [19], Curses::Colour::blue, Curses::Colour::yellow),
+               "colour pairs: restoring attributes after the pair was reused restores the colours");
+    }
+
+    class CountingTimer : public Timer
+    {
+    public:
+        std::atomic <long> ticks {0};
+
+        void timerCallback() override
+        {
+            ++ticks;
+        }
+    };
+
+    void checkTimers()
+    {
+        CountingTimer timer;
+        timer.startTimer (std::chrono::nanoseconds (0));
+        std::this_thread::sleep_for (std::chrono::milliseconds (20));
+        timer.stopTimer();
+
+        check (timer.ticks > 1 && timer.getStatistics().ticks == timer.ticks,
+               "timers: a timer with a zero period runs");
+
+        RenderLoop renderLoop;
+        renderLoop.start (0.0);
+        check (TimerService::getInstance().getNumRunningTimers() == 0,
+               "timers: a render loop started at zero frames per second does not run");
+    }
+
+    void ignoreCommand (Component&, double)
+    {
+    }
+
+    void checkCommandQueue()
+    {
+        const std::size_t capacity = 16;
+        RenderLoop renderLoop (capacity);
+        Slider target ("Ham");
+        std::atomic <bool> posting {true};
+
+        // Commands posted while a frame takes them must be left for the next frame, or a
+        // busy poster could keep the frame from ever being painted.
+        std::vector <std::thread> posters;
+
+        for (int i = 0; i < 4; ++i)
+        {
+            posters.emplace_back ([&]
+            {
+                while (posting)
+                {
+                    renderLoop.post (target, ignoreCommand, 0.0, false);
+                }
+            });
+        }
+
+        while (renderLoop.getQueueStatistics().depth < capacity)
+        {
+            std::this_thread::yield();
+        }
+
+        renderLoop.timerCallback();
+        long applied = renderLoop.getQueueStatistics().commandsApplied;
+        posting = false;
+
+        for (auto &poster : posters)
+        {
+            poster.join();
+        }
+
+        check (applied > 0 && applied <= static_cast <long> (capacity),
+               "commands: a frame applies no more commands than were waiting");
+    }
+}
+
+int main()
+{
+    memory = new MemoryBackend (screenWidth, screenHeight, 8, numColourPairs);
+    Curses::setBackend (std::unique_ptr <TerminalBackend> (memory));
+
+    checkLines();
+    checkEllipses();
+    checkBoxes();
+    checkWideText();
+    checkWindowCorner();
+    checkSliders();
+    checkColourPairs();
+    checkTimers();
+    checkCommandQueue();
+
+    std::printf ("%d failed\n", numFailures);
+    return numFailures == 0 ? 0 : 1;
+}
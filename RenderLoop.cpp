@@ -0,0 +1,204 @@
+#include "RenderLoop.hpp"
+#include <algorithm>
+#include <functional>
+#include "Component.hpp"
+#include "RepaintManager.hpp"
+
+RenderLoop::RenderLoop (std::size_t commandQueueCapacity)
+    : frameRate (0.0),
+      totalFrameTime (0),
+      commandQueue (commandQueueCapacity),
+      commandsPosted (0), commandsDropped (0),
+      commandsMerged (0), commandsApplied (0),
+      maximumQueueDepth (0)
+{
+    frameCommands.reserve (commandQueueCapacity);
+    mergeOrder.reserve (commandQueueCapacity);
+    superseded.reserve (commandQueueCapacity);
+
+    resetStatistics();
+}
+
+RenderLoop::~RenderLoop()
+{
+    stop();
+}
+
+void RenderLoop::start (double framesPerSecond)
+{
+    if (! (framesPerSecond > 0.0))
+    {
+        stop();
+        return;
+    }
+
+    frameRate = framesPerSecond;
+
+    std::chrono::duration <double> framePeriod (1.0 / frameRate);
+    startTimer (std::chrono::duration_cast <std::chrono::nanoseconds> (framePeriod));
+}
+
+void RenderLoop::stop()
+{
+    stopTimer();
+}
+
+double RenderLoop::getFrameRate() const
+{
+    return frameRate;
+}
+
+RenderLoop::FrameStatistics RenderLoop::getStatistics() const
+{
+    std::lock_guard <std::mutex> lock (statisticsMutex);
+    return statistics;
+}
+
+void RenderLoop::resetStatistics()
+{
+    std::lock_guard <std::mutex> lock (statisticsMutex);
+    statistics = FrameStatistics {0, 0, 0,
+                                  std::chrono::nanoseconds (0),
+                                  std::chrono::nanoseconds (0),
+                                  std::chrono::nanoseconds (0)};
+    totalFrameTime = std::chrono::nanoseconds (0);
+}
+
+bool RenderLoop::post (Component &target, CommandFunction function, double value, bool mergeable)
+{
+    if (! commandQueue.push (Command {function, &target, value, mergeable}))
+    {
+        commandsDropped.fetch_add (1, std::memory_order_relaxed);
+        return false;
+    }
+
+    commandsPosted.fetch_add (1, std::memory_order_relaxed);
+    return true;
+}
+
+RenderLoop::QueueStatistics RenderLoop::getQueueStatistics() const
+{
+    return QueueStatistics {commandQueue.getSize(),
+                            maximumQueueDepth.load(),
+                            commandsPosted.load(),
+                            commandsDropped.load(),
+                            commandsMerged.load(),
+                            commandsApplied.load()};
+}
+
+bool RenderLoop::applyCommands()
+{
+    // Only the commands waiting at the start of the frame are taken, so a thread posting
+    // as fast as the queue drains cannot keep the frame from being painted. Anything posted
+    // meanwhile waits for the next frame.
+    std::size_t depth = std::min (commandQueue.getSize(), commandQueue.getCapacity());
+    maximumQueueDepth = std::max (maximumQueueDepth.load(), depth);
+
+    Command command;
+
+    while (frameCommands.size() < depth && commandQueue.pop (command))
+    {
+        frameCommands.push_back (command);
+    }
+
+    if (frameCommands.empty())
+    {
+        return false;
+    }
+
+    // Only the last of each set of mergeable commands with the same function and target
+    // is applied, in the position it was posted. Sorting the positions of the mergeable
+    // commands brings each set together without allocating on the render thread.
+    mergeOrder.clear();
+    superseded.assign (frameCommands.size(), false);
+
+    for (std::size_t i = 0; i < frameCommands.size(); ++i)
+    {
+        if (frameCommands [i].mergeable)
+        {
+            mergeOrder.push_back (i);
+        }
+    }
+
+    std::sort (mergeOrder.begin(), mergeOrder.end(), [this] (std::size_t lhs, std::size_t rhs)
+    {
+        const Command &lhsCommand = frameCommands [lhs];
+        const Command &rhsCommand = frameCommands [rhs];
+
+        if (lhsCommand.function != rhsCommand.function)
+        {
+            return std::less <CommandFunction>() (lhsCommand.function, rhsCommand.function);
+        }
+
+        if (lhsCommand.target != rhsCommand.target)
+        {
+            return std::less <Component*>() (lhsCommand.target, rhsCommand.target);
+        }
+
+        return lhs < rhs;
+    });
+
+    for (std::size_t i = 1; i < mergeOrder.size(); ++i)
+    {
+        if (canMerge (frameCommands [mergeOrder [i - 1]], frameCommands [mergeOrder [i]]))
+        {
+            superseded [mergeOrder [i - 1]] = true;
+        }
+    }
+
+    long numApplied = 0;
+
+    {
+        Curses::Lock lock;
+
+        for (std::size_t i = 0; i < frameCommands.size(); ++i)
+        {
+            const Command &frameCommand = frameCommands [i];
+
+            if (superseded [i])
+            {
+                continue;
+            }
+
+            frameCommand.function (*frameCommand.target, frameCommand.value);
+            ++numApplied;
+        }
+    }
+
+    commandsApplied += numApplied;
+    commandsMerged += static_cast <long> (frameCommands.size()) - numApplied;
+    frameCommands.clear();
+
+    return true;
+}
+
+bool RenderLoop::canMerge (const Command &earlier, const Command &later)
+{
+    return earlier.function == later.function && earlier.target == later.target;
+}
+
+void RenderLoop::timerCallback()
+{
+    applyCommands();
+
+    RepaintManager &repaintManager = RepaintManager::getInstance();
+
+    if (! repaintManager.hasPendingWork())
+    {
+        std::lock_guard <std::mutex> lock (statisticsMutex);
+        ++statistics.framesSkipped;
+        return;
+    }
+
+    auto frameStart = std::chrono::steady_clock::now();
+    int numPainted = repaintManager.paintDirtyComponents();
+    auto frameTime = std::chrono::duration_cast <std::chrono::nanoseconds> (std::chrono::steady_clock::now() - frameStart);
+
+    std::lock_guard <std::mutex> lock (statisticsMutex);
+    ++statistics.framesPainted;
+    statistics.componentsInLastFrame = numPainted;
+    statistics.lastFrameTime = frameTime;
+    statistics.maximumFrameTime = std::max (statistics.maximumFrameTime, frameTime);
+    totalFrameTime += frameTime;
+    statistics.averageFrameTime = totalFrameTime / statistics.framesPainted;
+}
@@ -0,0 +1,132 @@
+#ifndef RENDER_LOOP_HPP_INCLUDED
+#define RENDER_LOOP_HPP_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include "Timer.hpp"
+#include "CommandQueue.hpp"
+
+class Component;
+
+/** A timer which paints invalidated components at a fixed frame rate.
+ *
+ *  Each frame paints the components waiting in the RepaintManager and refreshes the screen
+ *  once. Frames where nothing has been invalidated, no layout has changed and no panel has
+ *  moved are skipped without touching the terminal, so however fast components are invalidated the screen is written at most once
+ *  per frame, and a change becomes visible at the next frame.
+ *
+ *  The loop's thread can also be made the only thread which touches components and
+ *  ncurses. Other threads post() small commands instead of calling components directly.
+ *  The commands go through a bounded lock-free queue. The commands waiting at the start of
+ *  each frame are applied in that frame, and any posted while they are being taken wait for
+ *  the next, so posting never waits for the terminal or for a frame to finish, and never
+ *  holds up a frame.
+ */
+class RenderLoop : public Timer
+{
+public:
+    /** Constructor
+     *
+     *  @param commandQueueCapacity the number of commands which can be waiting for a frame
+     */
+    explicit RenderLoop (std::size_t commandQueueCapacity = 4096);
+    /** Destructor */
+    ~RenderLoop();
+
+    /** Start painting frames.
+     *
+     *  @param framesPerSecond the number of frames to paint per second. A rate of zero or
+     *                         less stops the loop instead.
+     */
+    void start (double framesPerSecond = 60.0);
+    /** Stop painting frames. */
+    void stop();
+
+    /** Returns the frame rate the loop runs at. */
+    double getFrameRate() const;
+
+    /** Timing information about the frames painted so far. */
+    struct FrameStatistics
+    {
+        long framesPainted; /**< The number of frames in which something was painted. */
+        long framesSkipped; /**< The number of frames skipped as there was nothing to paint. */
+        int componentsInLastFrame; /**< The number of components painted in the last frame. */
+        std::chrono::nanoseconds lastFrameTime; /**< How long the last painted frame took. */
+        std::chrono::nanoseconds averageFrameTime; /**< The mean time taken by painted frames. */
+        std::chrono::nanoseconds maximumFrameTime; /**< The longest time taken by a painted frame. */
+    };
+
+    /** Returns the timings of the frames painted since the statistics were last reset. */
+    FrameStatistics getStatistics() const;
+    /** Reset the frame statistics. */
+    void resetStatistics();
+
+    /** A function applied to a component on the render thread. */
+    using CommandFunction = void (*) (Component &target, double value);
+
+    /** Queue a command to be applied to a component at the start of the next frame.
+     *
+     *  May be called from any thread and never blocks. Mergeable commands replace any
+     *  earlier command with the same function and target still waiting in the same frame,
+     *  so only the latest value is applied. The target must outlive the command.
+     *
+     *  Returns false if the queue was full and the command was dropped.
+     *
+     *  @param target the component to apply the command to
+     *  @param function the function to call with the target and value
+     *  @param value the value to pass to the function
+     *  @param mergeable whether later commands may replace this one
+     */
+    bool post (Component &target, CommandFunction function, double value, bool mergeable = true);
+
+    /** Information about the flow of commands through the queue. */
+    struct QueueStatistics
+    {
+        std::size_t depth; /**< The number of commands currently waiting. */
+        std::size_t maximumDepth; /**< The most commands seen waiting at the start of a frame. */
+        long commandsPosted; /**< The number of commands successfully queued. */
+        long commandsDropped; /**< The number of commands dropped because the queue was full. */
+        long commandsMerged; /**< The number of commands replaced by a later command. */
+        long commandsApplied; /**< The number of commands applied to their targets. */
+    };
+
+    /** Returns statistics about the command queue. */
+    QueueStatistics getQueueStatistics() const;
+
+    /** Apply any queued commands and paint a frame. */
+    void timerCallback() override;
+
+private:
+    double frameRate;
+
+    mutable std::mutex statisticsMutex;
+    FrameStatistics statistics;
+    std::chrono::nanoseconds totalFrameTime;
+
+    struct Command
+    {
+        CommandFunction function;
+        Component *target;
+        double value;
+        bool mergeable;
+    };
+
+    CommandQueue <Command> commandQueue;
+    std::vector <Command> frameCommands;
+    /** The positions of the mergeable commands in frameCommands, sorted by target. */
+    std::vector <std::size_t> mergeOrder;
+    /** Whether each command in frameCommands is replaced by a later one. */
+    std::vector <char> superseded;
+
+    std::atomic <long> commandsPosted, commandsDropped;
+    std::atomic <long> commandsMerged, commandsApplied;
+    std::atomic <std::size_t> maximumQueueDepth;
+
+    bool applyCommands();
+    static bool canMerge (const Command &earlier, const Command &later);
+};
+
+#endif // RENDER_LOOP_HPP_INCLUDED
@@ -0,0 +1,236 @@
+#include "RepaintManager.hpp"
+#include <algorithm>
+#include "Component.hpp"
+
+RepaintManager::RepaintManager()
+    : lastPanelStackVersion (0),
+      paintPass (0)
+{
+}
+
+RepaintManager::~RepaintManager()
+{
+}
+
+RepaintManager& RepaintManager::getInstance()
+{
+    static RepaintManager instance;
+    return instance;
+}
+
+void RepaintManager::addDirtyComponent (Component &component)
+{
+    std::lock_guard <std::mutex> lock (dirtyMutex);
+
+    if (! component.repaintPending)
+    {
+        component.repaintPending = true;
+        dirtyComponents.push_back (&component);
+    }
+}
+
+void RepaintManager::addDirtyLayout (Component &component)
+{
+    std::lock_guard <std::mutex> lock (dirtyMutex);
+
+    if (! component.layoutPending)
+    {
+        component.layoutPending = true;
+        dirtyLayouts.push_back (&component);
+    }
+}
+
+void RepaintManager::addHiddenComponent (Component &component)
+{
+    if (! component.awaitingExposure)
+    {
+        component.awaitingExposure = true;
+        hiddenComponents.push_back (&component);
+    }
+}
+
+void RepaintManager::removeComponent (Component &component)
+{
+    Curses::Lock cursesLock;
+    std::lock_guard <std::mutex> lock (dirtyMutex);
+
+    if (component.repaintPending)
+    {
+        component.repaintPending = false;
+        dirtyComponents.erase (std::remove (dirtyComponents.begin(), dirtyComponents.end(), &component),
+                               dirtyComponents.end());
+    }
+
+    if (component.layoutPending)
+    {
+        component.layoutPending = false;
+        dirtyLayouts.erase (std::remove (dirtyLayouts.begin(), dirtyLayouts.end(), &component),
+                            dirtyLayouts.end());
+    }
+
+    if (component.awaitingExposure)
+    {
+        component.awaitingExposure = false;
+        hiddenComponents.erase (std::remove (hiddenComponents.begin(), hiddenComponents.end(), &component),
+                                hiddenComponents.end());
+    }
+
+    std::replace (layingOutComponents.begin(), layingOutComponents.end(), &component,
+                  static_cast <Component*> (nullptr));
+    std::replace (paintingComponents.begin(), paintingComponents.end(), &component,
+                  static_cast <Component*> (nullptr));
+}
+
+bool RepaintManager::hasDirtyComponents() const
+{
+    std::lock_guard <std::mutex> lock (dirtyMutex);
+    return ! dirtyComponents.empty();
+}
+
+bool RepaintManager::hasPendingWork() const
+{
+    // The panel stack version and lastPanelStackVersion are only changed with the Curses
+    // lock held, so it is taken first, as paintDirtyComponents does.
+    Curses::Lock cursesLock;
+
+    if (Curses::getInstance().getPanelStackVersion() != lastPanelStackVersion)
+    {
+        return true;
+    }
+
+    std::lock_guard <std::mutex> lock (dirtyMutex);
+    return ! dirtyComponents.empty() || ! dirtyLayouts.empty();
+}
+
+void RepaintManager::layOutDirtyComponents()
+{
+    {
+        std::lock_guard <std::mutex> lock (dirtyMutex);
+        layingOutComponents.swap (dirtyLayouts);
+
+        for (auto component : layingOutComponents)
+        {
+            component->layoutPending = false;
+        }
+    }
+
+    // Laying out a parent first sets its children's final bounds, which lays them out too
+    // if they changed, so by the time a child is reached its layout is usually up to date.
+    std::stable_sort (layingOutComponents.begin(), layingOutComponents.end(),
+                      [] (const Component *lhs, const Component *rhs)
+                      {
+                          return lhs->getDepth() < rhs->getDepth();
+                      });
+
+    for (std::size_t i = 0; i < layingOutComponents.size(); ++i)
+    {
+        if (layingOutComponents [i] != nullptr)
+        {
+            layingOutComponents [i]->layOutChildren();
+        }
+    }
+
+    layingOutComponents.clear();
+}
+
+int RepaintManager::paintDirtyComponents()
+{
+    // Holding the Curses lock for the whole pass stops components being removed while
+    // they are waiting to be painted.
+    Curses::Lock cursesLock;
+
+    layOutDirtyComponents();
+
+    Curses::Instance curses = Curses::getInstance();
+    unsigned long panelStackVersion = curses.getPanelStackVersion();
+    bool panelStackChanged = panelStackVersion != lastPanelStackVersion;
+    lastPanelStackVersion = panelStackVersion;
+
+    {
+        std::lock_guard <std::mutex> lock (dirtyMutex);
+        paintingComponents.swap (dirtyComponents);
+
+        for (auto component : paintingComponents)
+        {
+            component->repaintPending = false;
+        }
+
+        // Anything which was covered may have been uncovered, so it is painted again and
+        // put back on the list if it is still covered.
+        if (panelStackChanged)
+        {
+            for (auto component : hiddenComponents)
+            {
+                component->awaitingExposure = false;
+
+                if (std::find (paintingComponents.begin(), paintingComponents.end(), component)
+                    == paintingComponents.end())
+                {
+                    paintingComponents.push_back (component);
+                }
+            }
+
+            hiddenComponents.clear();
+        }
+    }
+
+    // Ancestors are painted before their descendants, so a lightweight component inside
+    // an area which has just been painted can be skipped.
+    std::stable_sort (paintingComponents.begin(), paintingComponents.end(),
+                      [] (const Component *lhs, const Component *rhs)
+                      {
+                          return lhs->getDepth() < rhs->getDepth();
+                      });
+
+    ++paintPass;
+    int numPainted = 0;
+
+    for (std::size_t i = 0; i < paintingComponents.size(); ++i)
+    {
+        Component *component = paintingComponents [i];
+
+        if (component == nullptr || isAreaPainted (*component))
+        {
+            continue;
+        }
+
+        component->paintPass = paintPass;
+
+        if (component->paint())
+        {
+            ++numPainted;
+        }
+    }
+
+    paintingComponents.clear();
+
+    if (numPainted > 0 || panelStackChanged)
+    {
+        curses.refreshScreen();
+    }
+
+    return numPainted;
+}
+
+bool RepaintManager::isAreaPainted (const Component &component) const
+{
+    if (! component.lightweight)
+    {
+        return false;
+    }
+
+    for (const Component *ancestor = component.parent; ancestor != nullptr; ancestor = ancestor->parent)
+    {
+        if (ancestor->paintPass == paintPass)
+        {
+            return true;
+        }
+
+        if (! ancestor->lightweight)
+        {
+            break;
+        }
+    }
+
+    return false;
+}
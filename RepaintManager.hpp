@@ -0,0 +1,109 @@
+#ifndef REPAINT_MANAGER_HPP_INCLUDED
+#define REPAINT_MANAGER_HPP_INCLUDED
+
+#include <mutex>
+#include <vector>
+
+class Component;
+
+/** A singleton class which collects components needing a repaint and paints them together.
+ *
+ *  Components call Component::invalidate() when their appearance changes. Nothing is drawn
+ *  until paintDirtyComponents() is called, at which point every invalidated component is
+ *  drawn once and the screen is refreshed once.
+ *
+ *  Components whose layouts have changed are collected in the same way, and are laid out
+ *  at the start of the next paint, parents before children, so a run of changes to a
+ *  layout only lays it out once.
+ *
+ *  A lightweight component is repainted on its own, by clearing and redrawing just its
+ *  area of its heavyweight ancestor's window, unless the ancestor or another component
+ *  around it is being repainted in the same pass anyway.
+ *
+ *  Only the parts of a component not covered by other panels are drawn, and a component
+ *  which is covered completely is not drawn at all. Such components are remembered and
+ *  painted again when the panels next move, are shown or hidden, or the screen is resized.
+ */
+class RepaintManager
+{
+public:
+    /** Destructor */
+    ~RepaintManager();
+
+    /** Get the singleton instance of the repaint manager. */
+    static RepaintManager& getInstance();
+
+    /** Mark a component as needing a repaint.
+     *
+     *  A component which is already waiting for a repaint is only painted once.
+     *  This may be called from any thread.
+     *
+     *  @param component the component to repaint
+     */
+    void addDirtyComponent (Component &component);
+    /** Mark a component as needing its children laid out again.
+     *
+     *  This may be called from any thread.
+     *
+     *  @param component the component to lay out
+     */
+    void addDirtyLayout (Component &component);
+    /** Remember a component which could not be drawn completely because it was covered.
+     *
+     *  It is painted again once the panel stack changes. The caller must hold a
+     *  Curses::Lock.
+     *
+     *  @param component the component which was covered
+     */
+    void addHiddenComponent (Component &component);
+    /** Forget about a component, for example because it is being destroyed.
+     *
+     *  @param component the component to forget
+     */
+    void removeComponent (Component &component);
+
+    /** Returns true if any components are waiting for a repaint. */
+    bool hasDirtyComponents() const;
+    /** Returns true if paintDirtyComponents() has anything to do.
+     *
+     *  As well as components waiting for a repaint, this counts components waiting for a
+     *  layout, and a change to the panel stack since the last paint, which means covered
+     *  components must be painted again and the screen refreshed.
+     */
+    bool hasPendingWork() const;
+
+    /** Lay out every component waiting for a layout, parents before children.
+     *
+     *  The caller must hold a Curses::Lock.
+     */
+    void layOutDirtyComponents();
+
+    /** Lay out and paint every component waiting for a repaint and refresh the screen once.
+     *
+     *  Returns the number of components which were painted, not counting those skipped
+     *  because they were covered. The screen is not refreshed when nothing was painted
+     *  and the panel stack has not changed.
+     */
+    int paintDirtyComponents();
+
+private:
+    RepaintManager();
+    RepaintManager (const RepaintManager&) = delete;
+    RepaintManager& operator= (const RepaintManager&) = delete;
+
+    mutable std::mutex dirtyMutex;
+    std::vector <Component*> dirtyComponents;
+    std::vector <Component*> paintingComponents;
+    std::vector <Component*> dirtyLayouts;
+    std::vector <Component*> layingOutComponents;
+    std::vector <Component*> hiddenComponents;
+    unsigned long lastPanelStackVersion;
+    unsigned long paintPass;
+
+    /** Returns true if a component's area has already been painted in this pass, as part of
+     *  an ancestor.
+     */
+    bool isAreaPainted (const Component &component) const;
+};
+
+#endif // REPAINT_MANAGER_HPP_INCLUDED
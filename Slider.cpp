@@ -1,128 +1,104 @@
 #include "Slider.hpp"
-#include <cmath>
-#include "MathsTools.hpp"
 
-Slider::Slider (const std::string &nameInit)
-    : name (nameInit),
-      value (0.0, 0.0, 1.0),
-      skewFactor (1.0),
+SliderBase::SliderBase (const std::string &nameInit)
+    : value (0.0, 0.0, 1.0),
       proportionOfLength (0.0),
       increment (0.1),
-      sliderHeight (0)
+      name (nameInit),
+      valueField (0, 0),
+      sliderHeight (0),
+      nameStart (0)
 {
+    // Every cell is drawn, so the value is only printed again when it changes.
+    setOpaque (true);
 }
 
-Slider::~Slider()
+SliderBase::~SliderBase()
 {
 }
 
-void Slider::setRange (double bottomValue, double topValue, double newSkewFactor)
-{
-    value.setRange (bottomValue, topValue);
-
-    if (skewFactor > 0.0)
-    {
-        skewFactor = newSkewFactor;
-    }
-
-    setValue (value);
-}
-
-void Slider::setValue (double newValue)
+double SliderBase::getValue() const
 {
-    value = newValue;
-    proportionOfLength = valueToProportionOfLength (value);
-    redraw();
+    return value;
 }
 
-void Slider::setProportionOfLength (double newProportionOfLength)
+double SliderBase::getProportionOfLength() const
 {
-    proportionOfLength = MathsTools::constrictValueToRange (newProportionOfLength,
-                                                            0.0, 1.0);
-    value = proportionOfLengthToValue (proportionOfLength);
-    redraw();
+    return proportionOfLength;
 }
 
-void Slider::incrementValue()
+void SliderBase::keyPressed (int key)
 {
-    setProportionOfLength (proportionOfLength + increment);
+    keyPressed (key, 1);
 }
 
-void Slider::decrementValue()
+void SliderBase::draw (Window::DrawSession &win)
 {
-    setProportionOfLength (proportionOfLength - increment);
-}
+    int width = getWidth();
+    int height = getHeight();
+    int y = height - 4;
+    int middle = (width - 1) / 2;
 
-double Slider::getValue() const
-{
-    return value;
-}
+    // The slider is opaque, so whatever is not drawn over is cleared here, leaving the
+    // value field alone.
+    win.clearRect (0, 0, middle - 1, height - 2);
+    win.clearRect (middle + 2, 0, width - middle - 2, height - 2);
+    win.clearRect (middle, 1, 1, height - 4);
 
-double Slider::valueToProportionOfLength (double valueToConvert)
-{
-    double range = value.getRange();
-    double bottomValue = value.getBottomValue();
+    int nameEnd = nameStart + win.getTextWidth (name);
+    win.clearRect (0, height - 1, nameStart, 1);
+    win.printString (name, nameStart, height - 1);
+    win.clearRect (nameEnd, height - 1, width - nameEnd, 1);
 
-    return pow (((valueToConvert - bottomValue) / range), skewFactor);
-}
+    win.clearRect (0, height - 2, nameStart, 1);
+    valueField.printDouble (win, value);
+    int valueEnd = nameStart + valueField.getLength();
+    win.clearRect (valueEnd, height - 2, width - valueEnd, 1);
 
-double Slider::proportionOfLengthToValue (double valueToConvert)
-{
-    double range = value.getRange();
-    double bottomValue = value.getBottomValue();
+    win.drawBox (middle - 1, 0, 3, height - 2);
 
-    return range * pow (valueToConvert, (1.0 / skewFactor)) + bottomValue;
-}
+    win.setForegroundColour (Curses::Colour::blue);
 
-void Slider::keyPressed (int key)
-{
-    switch (key)
+    for (double proportion = 0.0; proportion <= proportionOfLength - increment; proportion += increment)
     {
-        case KEY_UP:
-            incrementValue();
-            break;
-
-        case KEY_DOWN:
-            decrementValue();
-            break;
-
-        default:
-            break;
+        win.printCharacter (ACS_BLOCK, middle, y--);
     }
 }
 
-void Slider::draw (Window &win)
+void SliderBase::resized()
 {
     int width = getWidth();
     int height = getHeight();
+    sliderHeight = height - 4;
 
-    int nameStart = (width - 1 - name.size()) / 2;
+    increment = 1.0 / sliderHeight;
+
+    nameStart = (width - 1 - Curses::getInstance().getTextWidth (name)) / 2;
 
     if (nameStart < 0)
     {
         nameStart = 0;
     }
 
-    win.printString (name, nameStart, height - 1);
-    win.printDouble (value, nameStart, height - 2);
-
-    int y = height - 4;
-    int middle = (width - 1) / 2;
-
-    win.drawBox (middle - 1, 0, 3, height - 2);
+    valueField.setPosition (nameStart, height - 2);
+    valueField.setFormat (NumberFormat (2, 0, width - nameStart));
+}
 
-    win.setForegroundColour (Curses::Colour::blue);
+Slider::Slider (const std::string &nameInit)
+    : BasicSlider (nameInit)
+{
+}
 
-    for (double proportion = 0.0; proportion <= proportionOfLength - increment; proportion += increment)
-    {
-        win.printCharacter (ACS_BLOCK, middle, y--);
-    }
+Slider::~Slider()
+{
 }
 
-void Slider::resized()
+void Slider::setRange (double bottomValue, double topValue, double newSkewFactor)
 {
-    int height = getHeight();   
-    sliderHeight = height - 4;
+    if (newSkewFactor > 0.0)
+    {
+        setMapping (SliderMapping::Skew (newSkewFactor));
+    }
 
-    increment = 1.0 / sliderHeight;
+    BasicSlider::setRange (bottomValue, topValue);
 }
@@ -3,39 +3,135 @@
 
 #include "Component.hpp"
 #include <string>
+#include "MathsTools.hpp"
 #include "RangedValue.hpp"
+#include "SliderMapping.hpp"
 
-class Slider : public Component
+class SliderBase : public Component
 {
 public:
-    Slider (const std::string &nameInit);
-    ~Slider();
+    SliderBase (const std::string &nameInit);
+    ~SliderBase();
 
-    void setRange (double bottomValue, double topValue, double newSkewFactor = 1.0);
-
-    void setValue (double newValue);
-    void setProportionOfLength (double newProportionOfLength);
-    void incrementValue();
-    void decrementValue();
     double getValue() const;
+    double getProportionOfLength() const;
 
-    double valueToProportionOfLength (double valueToConvert);
-    double proportionOfLengthToValue (double valueToConvert);
-
+    using Component::keyPressed;
     void keyPressed (int key) override;
 
-private:
-    std::string name;
-
+protected:
     RangedValue <double> value;
-    double skewFactor;
     double proportionOfLength;
     double increment;
 
+private:
+    std::string name;
+    NumberField valueField;
+
     int sliderHeight;
+    int nameStart;
 
-    void draw (Window &win) override;
+    void draw (Window::DrawSession &win) override;
     void resized() override;
 };
 
+/** A slider whose value is mapped to its length by a policy from SliderMapping.
+ *
+ *  Everything which converts between the value and the proportion of the length lives
+ *  here rather than in SliderBase, so the policy's conversions are inlined where they are
+ *  used, with no virtual call in between.
+ */
+template <typename Mapping = SliderMapping::Linear>
+class BasicSlider : public SliderBase
+{
+public:
+    BasicSlider (const std::string &nameInit, const Mapping &mappingInit = Mapping())
+        : SliderBase (nameInit),
+          mapping (mappingInit)
+    {
+    }
+
+    void setRange (double bottomValue, double topValue)
+    {
+        value.setRange (bottomValue, topValue);
+        setValue (value);
+    }
+
+    void setMapping (const Mapping &newMapping)
+    {
+        mapping = newMapping;
+        setValue (value);
+    }
+
+    const Mapping& getMapping() const
+    {
+        return mapping;
+    }
+
+    void setValue (double newValue)
+    {
+        value = newValue;
+        proportionOfLength = valueToProportionOfLength (value);
+        invalidate();
+    }
+
+    void setProportionOfLength (double newProportionOfLength)
+    {
+        proportionOfLength = MathsTools::constrictValueToRange (newProportionOfLength, 0.0, 1.0);
+        value = proportionOfLengthToValue (proportionOfLength);
+        invalidate();
+    }
+
+    void incrementValue (int numSteps = 1)
+    {
+        setProportionOfLength (proportionOfLength + increment * numSteps);
+    }
+
+    void decrementValue (int numSteps = 1)
+    {
+        setProportionOfLength (proportionOfLength - increment * numSteps);
+    }
+
+    double valueToProportionOfLength (double valueToConvert) const
+    {
+        return mapping.toProportion (valueToConvert, value.getBottomValue(), value.getTopValue());
+    }
+
+    double proportionOfLengthToValue (double valueToConvert) const
+    {
+        return mapping.toValue (valueToConvert, value.getBottomValue(), value.getTopValue());
+    }
+
+    using SliderBase::keyPressed;
+
+    void keyPressed (int key, int repeatCount) final
+    {
+        switch (key)
+        {
+            case KEY_UP:
+                incrementValue (repeatCount);
+                break;
+
+            case KEY_DOWN:
+                decrementValue (repeatCount);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+private:
+    Mapping mapping;
+};
+
+class Slider : public BasicSlider <SliderMapping::Skew>
+{
+public:
+    Slider (const std::string &nameInit);
+    ~Slider();
+
+    void setRange (double bottomValue, double topValue, double newSkewFactor = 1.0);
+};
+
 #endif // SLIDER_HPP_INCLUDED
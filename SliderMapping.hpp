@@ -0,0 +1,198 @@
+#ifndef SLIDER_MAPPING_HPP_INCLUDED
+#define SLIDER_MAPPING_HPP_INCLUDED
+
+#include <cmath>
+#include "MathsTools.hpp"
+
+/** Mapping policies which convert between a slider's value and the proportion of its length.
+ *
+ *  A policy has two const member functions:
+ *
+ *      double toProportion (double value, double bottomValue, double topValue) const;
+ *      double toValue (double proportion, double bottomValue, double topValue) const;
+ *
+ *  where a proportion of 0 is the bottom of the range and 1 is the top. BasicSlider is
+ *  parameterised on a policy, so the conversions are inlined into the slider.
+ */
+namespace SliderMapping
+{
+    /** Returns where a value lies between the bottom and the top of a range, as 0 to 1. */
+    inline double normalise (double value, double bottomValue, double topValue)
+    {
+        return (value - bottomValue) / (topValue - bottomValue);
+    }
+
+    /** Returns the value which lies a proportion of the way from the bottom to the top. */
+    inline double denormalise (double proportion, double bottomValue, double topValue)
+    {
+        return (topValue - bottomValue) * proportion + bottomValue;
+    }
+
+    /** Spaces values evenly along the slider. */
+    struct Linear
+    {
+        /** @see SliderMapping */
+        double toProportion (double value, double bottomValue, double topValue) const
+        {
+            return normalise (value, bottomValue, topValue);
+        }
+
+        /** @see SliderMapping */
+        double toValue (double proportion, double bottomValue, double topValue) const
+        {
+            return denormalise (proportion, bottomValue, topValue);
+        }
+    };
+
+    /** Raises the normalised value to a fixed whole power, which gives more of the slider
+     *  to the bottom of the range as the exponent grows.
+     *
+     *  The forward conversion is a chain of multiplications, and the inverses of the
+     *  squares and cubes use sqrt and cbrt.
+     */
+    template <int Exponent>
+    struct IntegerSkew
+    {
+        static_assert (Exponent > 0, "The exponent must be positive");
+
+        /** @see SliderMapping */
+        double toProportion (double value, double bottomValue, double topValue) const
+        {
+            return MathsTools::integerPower <Exponent> (normalise (value, bottomValue, topValue));
+        }
+
+        /** @see SliderMapping */
+        double toValue (double proportion, double bottomValue, double topValue) const
+        {
+            return denormalise (root (proportion), bottomValue, topValue);
+        }
+
+    private:
+        static double root (double proportion)
+        {
+            switch (Exponent)
+            {
+                case 1:
+                    return proportion;
+
+                case 2:
+                    return std::sqrt (proportion);
+
+                case 3:
+                    return std::cbrt (proportion);
+
+                default:
+                    return std::pow (proportion, 1.0 / Exponent);
+            }
+        }
+    };
+
+    /** Raises the normalised value to a power chosen at run time.
+     *
+     *  A skew factor of 1 is linear and skips the calls to pow.
+     */
+    struct Skew
+    {
+        /** Constructor
+         *
+         *  @param skewFactorInit the power to raise normalised values to, which must be
+         *                        greater than 0
+         */
+        explicit Skew (double skewFactorInit = 1.0)
+            : skewFactor (skewFactorInit)
+        {
+        }
+
+        /** @see SliderMapping */
+        double toProportion (double value, double bottomValue, double topValue) const
+        {
+            double proportion = normalise (value, bottomValue, topValue);
+            return skewFactor == 1.0 ? proportion : std::pow (proportion, skewFactor);
+        }
+
+        /** @see SliderMapping */
+        double toValue (double proportion, double bottomValue, double topValue) const
+        {
+            return denormalise (skewFactor == 1.0 ? proportion : std::pow (proportion, 1.0 / skewFactor),
+                                bottomValue, topValue);
+        }
+
+        /** Returns the power normalised values are raised to. */
+        double getSkewFactor() const
+        {
+            return skewFactor;
+        }
+
+    private:
+        double skewFactor;
+    };
+
+    /** Spaces values so that equal ratios take equal lengths of the slider, as for
+     *  frequencies or gains.
+     *
+     *  Both ends of the range must be non-zero and have the same sign.
+     */
+    struct Logarithmic
+    {
+        /** @see SliderMapping */
+        double toProportion (double value, double bottomValue, double topValue) const
+        {
+            return std::log (value / bottomValue) / std::log (topValue / bottomValue);
+        }
+
+        /** @see SliderMapping */
+        double toValue (double proportion, double bottomValue, double topValue) const
+        {
+            return bottomValue * std::pow (topValue / bottomValue, proportion);
+        }
+    };
+
+    /** Applies a user supplied curve to the normalised value.
+     *
+     *  The curve and its inverse are both functions from 0 to 1 onto 0 to 1. They can be
+     *  function pointers, lambdas or any other function objects. Use makeCurve() to avoid
+     *  naming their types.
+     */
+    template <typename Curve, typename InverseCurve>
+    struct UserCurve
+    {
+        /** Constructor
+         *
+         *  @param curveInit maps a normalised value to a proportion
+         *  @param inverseCurveInit maps a proportion back to a normalised value
+         */
+        UserCurve (const Curve &curveInit, const InverseCurve &inverseCurveInit)
+            : curve (curveInit), inverseCurve (inverseCurveInit)
+        {
+        }
+
+        /** @see SliderMapping */
+        double toProportion (double value, double bottomValue, double topValue) const
+        {
+            return curve (normalise (value, bottomValue, topValue));
+        }
+
+        /** @see SliderMapping */
+        double toValue (double proportion, double bottomValue, double topValue) const
+        {
+            return denormalise (inverseCurve (proportion), bottomValue, topValue);
+        }
+
+    private:
+        Curve curve;
+        InverseCurve inverseCurve;
+    };
+
+    /** Make a UserCurve from a curve and its inverse.
+     *
+     *  @param curve maps a normalised value to a proportion
+     *  @param inverseCurve maps a proportion back to a normalised value
+     */
+    template <typename Curve, typename InverseCurve>
+    UserCurve <Curve, InverseCurve> makeCurve (const Curve &curve, const InverseCurve &inverseCurve)
+    {
+        return UserCurve <Curve, InverseCurve> (curve, inverseCurve);
+    }
+}
+
+#endif // SLIDER_MAPPING_HPP_INCLUDED
@@ -0,0 +1,114 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "MathsTools.hpp"
+
+/** Times the MathsTools span functions with each instruction set against the scalar code,
+ *  and checks every instruction set gives the same results.
+ *
+ *  Build with "make benchmark" and run ./span-benchmark.
+ */
+
+namespace
+{
+    const std::size_t numSamples = 4096;
+    const int numRepeats = 20000;
+
+    const char* getName (MathsTools::SpanInstructions instructions)
+    {
+        switch (instructions)
+        {
+            case MathsTools::SpanInstructions::avx2:
+                return "avx2";
+
+            case MathsTools::SpanInstructions::sse2:
+                return "sse2";
+
+            default:
+                return "scalar";
+        }
+    }
+
+    template <typename Function>
+    double timeNanosecondsPerSample (Function function)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        for (int repeat = 0; repeat < numRepeats; ++repeat)
+        {
+            function();
+        }
+
+        std::chrono::duration <double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / (static_cast <double> (numRepeats) * numSamples);
+    }
+}
+
+int main()
+{
+    std::mt19937 generator (1234);
+    std::uniform_real_distribution <double> distribution (-50.0, 150.0);
+    std::vector <double> samples (numSamples);
+
+    for (auto &sample : samples)
+    {
+        sample = distribution (generator);
+    }
+
+    std::vector <double> expectedClamped (numSamples), expectedNormalised (numSamples);
+    std::vector <int> expectedCounts (numSamples);
+
+    MathsTools::clampSpan (samples.data(), expectedClamped.data(), numSamples, 0.0, 100.0,
+                           MathsTools::SpanInstructions::scalar);
+    MathsTools::normaliseSpan (samples.data(), expectedNormalised.data(), numSamples, 0.0, 100.0,
+                               MathsTools::SpanInstructions::scalar);
+    MathsTools::proportionsToCellCounts (expectedNormalised.data(), expectedCounts.data(), numSamples, 35,
+                                         MathsTools::SpanInstructions::scalar);
+
+    std::vector <double> clamped (numSamples), normalised (numSamples);
+    std::vector <int> counts (numSamples);
+
+    std::printf ("best instructions: %s\n", getName (MathsTools::getBestSpanInstructions()));
+    std::printf ("%-8s %14s %14s %14s\n", "", "clamp ns/val", "normalise", "cell counts");
+
+    bool allMatched = true;
+
+    for (auto instructions : {MathsTools::SpanInstructions::scalar,
+                              MathsTools::SpanInstructions::sse2,
+                              MathsTools::SpanInstructions::avx2})
+    {
+        if (instructions > MathsTools::getBestSpanInstructions())
+        {
+            std::printf ("%-8s not supported\n", getName (instructions));
+            continue;
+        }
+
+        double clampTime = timeNanosecondsPerSample ([&] ()
+                           {
+                               MathsTools::clampSpan (samples.data(), clamped.data(), numSamples,
+                                                      0.0, 100.0, instructions);
+                           });
+        double normaliseTime = timeNanosecondsPerSample ([&] ()
+                               {
+                                   MathsTools::normaliseSpan (samples.data(), normalised.data(), numSamples,
+                                                              0.0, 100.0, instructions);
+                               });
+        double countTime = timeNanosecondsPerSample ([&] ()
+                           {
+                               MathsTools::proportionsToCellCounts (normalised.data(), counts.data(), numSamples,
+                                                                    35, instructions);
+                           });
+
+        bool matched = std::memcmp (clamped.data(), expectedClamped.data(), numSamples * sizeof (double)) == 0
+                       && std::memcmp (normalised.data(), expectedNormalised.data(), numSamples * sizeof (double)) == 0
+                       && counts == expectedCounts;
+        allMatched = allMatched && matched;
+
+        std::printf ("%-8s %14.3f %14.3f %14.3f%s\n", getName (instructions),
+                     clampTime, normaliseTime, countTime, matched ? "" : "  MISMATCH");
+    }
+
+    return allMatched ? 0 : 1;
+}
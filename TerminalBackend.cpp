@@ -0,0 +1,9 @@
+#include "TerminalBackend.hpp"
+
+TerminalWindow::~TerminalWindow()
+{
+}
+
+TerminalBackend::~TerminalBackend()
+{
+}
@@ -0,0 +1,130 @@
+#ifndef TERMINAL_BACKEND_HPP_INCLUDED
+#define TERMINAL_BACKEND_HPP_INCLUDED
+
+#include <memory>
+#include <curses.h>
+
+/** A rectangle of cells on a terminal, stacked above or below the other windows.
+ *
+ *  The functions match the ncurses functions Window needs, and behave as they do. Positions
+ *  are relative to the window. Callers must hold a Curses::Lock.
+ */
+class TerminalWindow
+{
+public:
+    /** Destructor */
+    virtual ~TerminalWindow();
+
+    /** Returns the x position of the window on the screen. */
+    virtual int getX() const = 0;
+    /** Returns the y position of the window on the screen. */
+    virtual int getY() const = 0;
+    /** Returns the width of the window, which is never less than 1. */
+    virtual int getWidth() const = 0;
+    /** Returns the height of the window, which is never less than 1. */
+    virtual int getHeight() const = 0;
+
+    /** Move the window, like move_panel.
+     *
+     *  @param x the new x position
+     *  @param y the new y position
+     */
+    virtual void move (int x, int y) = 0;
+    /** Move and resize the window, keeping its contents.
+     *
+     *  @param x the new x position
+     *  @param y the new y position
+     *  @param width the new width, at least 1
+     *  @param height the new height, at least 1
+     */
+    virtual void setBounds (int x, int y, int width, int height) = 0;
+
+    /** Take the window off the screen, like hide_panel. */
+    virtual void hide() = 0;
+    /** Put the window back on the screen at the top of the stack, like show_panel. */
+    virtual void show() = 0;
+    /** Returns true if the window is hidden. */
+    virtual bool isHidden() const = 0;
+    /** Returns the window shown immediately above this one, or nullptr if there is none. */
+    virtual const TerminalWindow* getWindowAbove() const = 0;
+
+    /** Set the attributes and colour pair used by addCharacter, addString and the line
+     *  drawing functions, like wattr_set.
+     */
+    virtual void setAttributes (attr_t attributes, short colourPair) = 0;
+    /** Move the cursor, like wmove. Positions outside the window are ignored. */
+    virtual void moveCursor (int x, int y) = 0;
+    /** Returns the x position of the cursor. */
+    virtual int getCursorX() const = 0;
+    /** Returns the y position of the cursor. */
+    virtual int getCursorY() const = 0;
+
+    /** Write a character at the cursor with the window's attributes and advance the
+     *  cursor, like waddch.
+     */
+    virtual void addCharacter (const chtype character) = 0;
+    /** Write a character at a position, like mvwaddch. */
+    virtual void addCharacter (const chtype character, int x, int y) = 0;
+    /** Write a string at the cursor, like waddnstr. */
+    virtual void addString (const char *string, int length) = 0;
+    /** Write a string at a position, like mvwaddnstr. */
+    virtual void addString (const char *string, int length, int x, int y) = 0;
+    /** Copy rendered characters to a row without moving the cursor, like mvwaddchnstr. */
+    virtual void setCells (const chtype *characters, int length, int x, int y) = 0;
+    /** Copy wide characters to a row without moving the cursor, like mvwadd_wchnstr. */
+    virtual void setWideCells (const cchar_t *characters, int length, int x, int y) = 0;
+    /** Draw a horizontal line to the right of a position, like mvwhline. */
+    virtual void drawHorizontalLine (const chtype character, int x, int y, int length) = 0;
+    /** Draw a vertical line downwards from a position, like mvwvline. */
+    virtual void drawVerticalLine (const chtype character, int x, int y, int length) = 0;
+    /** Blank every cell and move the cursor to the top left, like werase. */
+    virtual void erase() = 0;
+};
+
+/** Where Curses sends its output and gets its input from.
+ *
+ *  NcursesBackend drives a real terminal. MemoryBackend keeps the screen in memory, so
+ *  drawing can be tested and benchmarked without one.
+ *
+ *  Callers must hold a Curses::Lock.
+ */
+class TerminalBackend
+{
+public:
+    /** Destructor */
+    virtual ~TerminalBackend();
+
+    /** Returns the width of the screen in characters. */
+    virtual int getScreenWidth() const = 0;
+    /** Returns the height of the screen in characters. */
+    virtual int getScreenHeight() const = 0;
+    /** Resize the screen to match the terminal. Returns true if the size changed. */
+    virtual bool updateScreenSize() = 0;
+
+    /** Returns the number of colours the terminal can show. */
+    virtual int getNumColours() const = 0;
+    /** Returns the number of colour pairs, including the default pair 0, or 0 if the
+     *  terminal has no colours.
+     */
+    virtual int getNumColourPairs() const = 0;
+    /** Set the colours of a colour pair, like init_pair. */
+    virtual void initialiseColourPair (short pair, short foregroundColour, short backgroundColour) = 0;
+
+    /** Set how the cursor is shown, like curs_set. */
+    virtual void setCursorVisibility (int visibility) = 0;
+    /** Show everything drawn since the last refresh. */
+    virtual void refresh() = 0;
+    /** Returns the next key pressed, or ERR if there is none waiting. Never waits. */
+    virtual int readKey() = 0;
+
+    /** Create a window at the top of the stack.
+     *
+     *  @param x the x position of the window
+     *  @param y the y position of the window
+     *  @param width the width of the window, at least 1
+     *  @param height the height of the window, at least 1
+     */
+    virtual std::unique_ptr <TerminalWindow> createWindow (int x, int y, int width, int height) = 0;
+};
+
+#endif // TERMINAL_BACKEND_HPP_INCLUDED
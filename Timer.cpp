@@ -1,7 +1,9 @@
 #include "Timer.hpp"
+#include "TimerService.hpp"
 
 Timer::Timer()
     : callbackPeriod (0),
+      statistics (),
       controlFlag (ControlState::Stopped)
 {
 }
@@ -11,55 +13,41 @@ Timer::~Timer()
     stopTimer();
 }
 
-void Timer::startTimer (const std::chrono::milliseconds &newCallbackPeriod)
+void Timer::startTimer (const std::chrono::nanoseconds &newCallbackPeriod)
 {
-    std::unique_lock <std::mutex> lock (controlMutex);
-    callbackPeriod = newCallbackPeriod;
-
-    ControlState oldState = controlFlag;
-    controlFlag = ControlState::Running;
-
-    if (oldState == ControlState::Stopped)
-    {
-        timerThread = std::thread ([this] () {run();});
-    }
+    TimerService::getInstance().startTimer (*this, newCallbackPeriod);
 }
 
 void Timer::pauseTimer()
 {
-    std::unique_lock <std::mutex> lock (controlMutex);
-    controlFlag = ControlState::Paused;
-    controlCondition.notify_one();
+    TimerService::getInstance().stopTimer (*this, ControlState::Paused);
 }
 
 void Timer::stopTimer()
 {
-    std::unique_lock <std::mutex> lock (controlMutex);
-    controlFlag = ControlState::Stopped;
-    controlCondition.notify_one();
-    lock.unlock();
-    timerThread.join();
+    TimerService::getInstance().stopTimer (*this, ControlState::Stopped);
 }
 
-void Timer::run()
+Timer::Statistics Timer::getStatistics() const
 {
-    while (true)
-    {
-        std::unique_lock <std::mutex> lock (controlMutex);
+    return TimerService::getInstance().getStatistics (*this);
+}
 
-        switch (controlFlag)
-        {
-            case ControlState::Running:
-                timerCallback();
-                controlCondition.wait_for (lock, callbackPeriod);
-                break;
+void Timer::resetStatistics()
+{
+    TimerService::getInstance().resetStatistics (*this);
+}
 
-            case ControlState::Paused:
-                std::this_thread::yield();
-                break;
+int Timer::getHistogramBucket (const std::chrono::nanoseconds &duration)
+{
+    auto microseconds = std::chrono::duration_cast <std::chrono::microseconds> (duration).count();
+    int bucket = 0;
 
-            case ControlState::Stopped:
-                return;
-        }
+    while (microseconds > 0 && bucket < numHistogramBuckets - 1)
+    {
+        microseconds >>= 1;
+        ++bucket;
     }
+
+    return bucket;
 }
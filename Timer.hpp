@@ -1,15 +1,20 @@
 #ifndef TIMER_HPP_INCLUDED
 #define TIMER_HPP_INCLUDED
 
-#include <thread>
-#include <mutex>
-#include <condition_variable>
+#include <array>
 #include <chrono>
 
 /** A timer class which calls a given function periodically.
  *
  *  Classes which inherit this class will have their implementation timerCallback() called
  *  periodically.
+ *
+ *  Timers do not own a thread. Every timer is scheduled by the TimerService, which calls
+ *  the callbacks of all timers from a single thread.
+ *
+ *  Callbacks are scheduled against absolute deadlines one period apart, so the time taken
+ *  by a callback does not make the timer drift. If a callback overruns one or more whole
+ *  periods the missed ticks are skipped and counted rather than called late in a burst.
  */
 class Timer
 {
@@ -24,20 +29,23 @@ public:
      *  Starts the timer such that timerCallback() will be called periodically using the
      *  provided period.
      *
-     *  @param newCallbackPeriod the new callback period
+     *  @param newCallbackPeriod the new callback period. A period of zero or less is
+     *                           treated as one nanosecond.
      *
-     *  If the timer is currently stopped this involves the starting of a new thread.
+     *  If the timer is currently stopped or paused the first callback happens straight away,
+     *  otherwise the next callback happens one new period from now.
      */
-    void startTimer (const std::chrono::milliseconds &newCallbackPeriod);
+    void startTimer (const std::chrono::nanoseconds &newCallbackPeriod);
     /** Pause the timer.
      *
-     *  Causes the timer thread to busy sleep. The timerCallback() will no longer get called
-     *  by the thread will continue to run in the background.
+     *  The timerCallback() will no longer get called until the timer is started again. If
+     *  the callback is running on another thread this waits for it to finish.
      */
     void pauseTimer();
     /** Stop the timer.
      *
-     *  Causes the timer thread to exit.
+     *  The timerCallback() will no longer get called. If the callback is running on another
+     *  thread this waits for it to finish.
      */
     void stopTimer();
 
@@ -47,11 +55,41 @@ public:
      */
     virtual void timerCallback() = 0;
 
+    /** The number of buckets in each histogram in the timer statistics.
+     *
+     *  Bucket 0 counts durations under 1us, bucket n counts durations from 2^(n-1)us up to
+     *  2^n us, and the last bucket also counts anything longer.
+     */
+    static const int numHistogramBuckets = 16;
+    using Histogram = std::array <long, numHistogramBuckets>;
+
+    /** Information about how accurately the timer has been called. */
+    struct Statistics
+    {
+        long ticks; /**< The number of times the callback has been called. */
+        long missedTicks; /**< The number of ticks skipped because a callback overran. */
+        std::chrono::nanoseconds maximumLateness; /**< The latest a callback has started. */
+        std::chrono::nanoseconds totalLateness; /**< The sum of the lateness of every callback. */
+        Histogram latenessHistogram; /**< How late callbacks started after their deadlines. */
+        Histogram jitterHistogram; /**< How far the time between callbacks strayed from the period. */
+    };
+
+    /** Returns the statistics gathered since the timer was created or last reset. */
+    Statistics getStatistics() const;
+    /** Reset the timer statistics. */
+    void resetStatistics();
+
+    /** Returns the histogram bucket a duration falls in.
+     *
+     *  @param duration the duration to look up
+     */
+    static int getHistogramBucket (const std::chrono::nanoseconds &duration);
+
 private:
-    std::thread timerThread;
-    std::mutex controlMutex;
-    std::condition_variable controlCondition;
-    std::chrono::milliseconds callbackPeriod;
+    std::chrono::nanoseconds callbackPeriod;
+
+    Statistics statistics;
+    std::chrono::steady_clock::time_point lastCallbackStart;
 
     enum class ControlState
     {
@@ -60,7 +98,7 @@ private:
         Stopped
     } controlFlag;
 
-    void run();
+    friend class TimerService;
 };
 
 #endif // TIMER_HPP_INCLUDED
@@ -0,0 +1,398 @@
+#include "TimerService.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+#if defined (__linux__)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    /** Orders heap entries so the earliest deadline is at the front. */
+    struct LaterDeadline
+    {
+        template <typename Entry>
+        bool operator() (const Entry &lhs, const Entry &rhs) const
+        {
+            return lhs.deadline > rhs.deadline;
+        }
+    };
+}
+
+constexpr std::chrono::microseconds TimerService::preciseWaitThreshold;
+
+TimerService::TimerService()
+    : numRunningTimers (0),
+      numPreciseTimers (0),
+      coalescingWindow (std::chrono::milliseconds (1)),
+      timerFd (-1), wakeFd (-1),
+      timerInCallback (nullptr),
+      callbackTimerChanged (false),
+      shouldExit (false)
+{
+#if defined (__linux__)
+    timerFd = timerfd_create (CLOCK_MONOTONIC, TFD_CLOEXEC);
+    wakeFd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+#endif
+
+    startServiceThread();
+}
+
+TimerService::~TimerService()
+{
+    std::unique_lock <std::mutex> lock (serviceMutex);
+    shouldExit = true;
+    wake();
+    lock.unlock();
+
+    if (serviceThread.joinable())
+    {
+        serviceThread.join();
+    }
+
+#if defined (__linux__)
+    if (timerFd >= 0)
+    {
+        close (timerFd);
+    }
+
+    if (wakeFd >= 0)
+    {
+        close (wakeFd);
+    }
+#endif
+}
+
+TimerService& TimerService::getInstance()
+{
+    static TimerService instance;
+    return instance;
+}
+
+void TimerService::setCoalescingWindow (const std::chrono::nanoseconds &newCoalescingWindow)
+{
+    std::unique_lock <std::mutex> lock (serviceMutex);
+    coalescingWindow = newCoalescingWindow;
+}
+
+std::size_t TimerService::getNumRunningTimers() const
+{
+    std::unique_lock <std::mutex> lock (serviceMutex);
+    return numRunningTimers;
+}
+
+void TimerService::startTimer (Timer &timer, const std::chrono::nanoseconds &requestedPeriod)
+{
+    // Deadlines and jitter are worked out by dividing by the period, so a period of zero
+    // or less runs as fast as it can with the shortest period instead.
+    std::chrono::nanoseconds period = std::max (requestedPeriod, std::chrono::nanoseconds (1));
+
+    std::unique_lock <std::mutex> lock (serviceMutex);
+
+    Clock::time_point deadline = Clock::now();
+    bool wasRunning = timer.controlFlag == Timer::ControlState::Running;
+
+    if (wasRunning)
+    {
+        deadline += period;
+        setRunning (timer, false);
+        removeEntries (timer);
+    }
+
+    if (timerInCallback == &timer)
+    {
+        callbackTimerChanged = true;
+    }
+
+    timer.callbackPeriod = period;
+    timer.controlFlag = Timer::ControlState::Running;
+    timer.lastCallbackStart = Clock::time_point();
+    setRunning (timer, true);
+
+    pushEntry (Entry {deadline, &timer});
+    wake();
+}
+
+void TimerService::stopTimer (Timer &timer, Timer::ControlState newState)
+{
+    std::unique_lock <std::mutex> lock (serviceMutex);
+
+    if (timer.controlFlag == Timer::ControlState::Running)
+    {
+        setRunning (timer, false);
+        removeEntries (timer);
+    }
+
+    if (timerInCallback == &timer)
+    {
+        callbackTimerChanged = true;
+    }
+
+    timer.controlFlag = newState;
+
+    // A timer stopping itself from its own callback must not wait for the callback.
+    if (std::this_thread::get_id() != dispatchThread)
+    {
+        callbackFinished.wait (lock, [this, &timer] () {return timerInCallback != &timer;});
+    }
+}
+
+Timer::Statistics TimerService::getStatistics (const Timer &timer) const
+{
+    std::unique_lock <std::mutex> lock (serviceMutex);
+    return timer.statistics;
+}
+
+void TimerService::resetStatistics (Timer &timer)
+{
+    std::unique_lock <std::mutex> lock (serviceMutex);
+    timer.statistics = Timer::Statistics();
+}
+
+void TimerService::setRunning (Timer &timer, bool running)
+{
+    int change = running ? 1 : -1;
+    numRunningTimers += change;
+
+    if (timer.callbackPeriod < preciseWaitThreshold)
+    {
+        numPreciseTimers += change;
+    }
+}
+
+void TimerService::wake()
+{
+    if (externalWake)
+    {
+        externalWake();
+        return;
+    }
+
+    scheduleChanged.notify_one();
+
+#if defined (__linux__)
+    if (wakeFd >= 0)
+    {
+        eventfd_write (wakeFd, 1);
+    }
+#endif
+}
+
+void TimerService::waitUntil (std::unique_lock <std::mutex> &lock, Clock::time_point deadline)
+{
+    bool forever = deadline == Clock::time_point::max();
+
+#if defined (__linux__)
+    if (numPreciseTimers > 0 && timerFd >= 0 && wakeFd >= 0)
+    {
+        itimerspec expiry {};
+
+        if (! forever)
+        {
+            auto sinceEpoch = std::chrono::duration_cast <std::chrono::nanoseconds> (deadline.time_since_epoch());
+            expiry.it_value.tv_sec = static_cast <time_t> (sinceEpoch.count() / 1000000000);
+            expiry.it_value.tv_nsec = static_cast <long> (sinceEpoch.count() % 1000000000);
+        }
+
+        timerfd_settime (timerFd, TFD_TIMER_ABSTIME, &expiry, nullptr);
+
+        lock.unlock();
+
+        // Anything which changes the schedule while the lock is released also writes to
+        // wakeFd, so no wakeup can be missed.
+        pollfd descriptors [2] = {{timerFd, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+        poll (descriptors, 2, -1);
+
+        std::uint64_t count = 0;
+
+        if (descriptors [0].revents & POLLIN)
+        {
+            ssize_t ignored = read (timerFd, &count, sizeof (count));
+            (void) ignored;
+        }
+
+        if (descriptors [1].revents & POLLIN)
+        {
+            eventfd_read (wakeFd, &count);
+        }
+
+        lock.lock();
+        return;
+    }
+#endif
+
+    if (forever)
+    {
+        scheduleChanged.wait (lock);
+    }
+    else
+    {
+        scheduleChanged.wait_until (lock, deadline);
+    }
+}
+
+void TimerService::recordCallback (Timer &timer, Clock::time_point deadline, Clock::time_point start)
+{
+    Timer::Statistics &statistics = timer.statistics;
+    auto lateness = std::max (std::chrono::duration_cast <std::chrono::nanoseconds> (start - deadline),
+                              std::chrono::nanoseconds (0));
+
+    ++statistics.ticks;
+    statistics.maximumLateness = std::max (statistics.maximumLateness, lateness);
+    statistics.totalLateness += lateness;
+    ++statistics.latenessHistogram [Timer::getHistogramBucket (lateness)];
+
+    if (timer.lastCallbackStart != Clock::time_point())
+    {
+        auto interval = std::chrono::duration_cast <std::chrono::nanoseconds> (start - timer.lastCallbackStart);
+        auto period = timer.callbackPeriod;
+        auto expectedInterval = period * ((interval + period / 2) / period);
+        auto jitter = std::chrono::nanoseconds (std::llabs ((interval - expectedInterval).count()));
+
+        ++statistics.jitterHistogram [Timer::getHistogramBucket (jitter)];
+    }
+
+    timer.lastCallbackStart = start;
+}
+
+void TimerService::pushEntry (const Entry &entry)
+{
+    heap.push_back (entry);
+    std::push_heap (heap.begin(), heap.end(), LaterDeadline());
+}
+
+TimerService::Entry TimerService::popEntry()
+{
+    std::pop_heap (heap.begin(), heap.end(), LaterDeadline());
+    Entry entry = heap.back();
+    heap.pop_back();
+
+    return entry;
+}
+
+void TimerService::removeEntries (const Timer &timer)
+{
+    auto removed = std::remove_if (heap.begin(), heap.end(),
+                                   [&timer] (const Entry &entry) {return entry.timer == &timer;});
+
+    if (removed != heap.end())
+    {
+        heap.erase (removed, heap.end());
+        std::make_heap (heap.begin(), heap.end(), LaterDeadline());
+    }
+}
+
+void TimerService::startServiceThread()
+{
+    std::unique_lock <std::mutex> lock (serviceMutex);
+    serviceThread = std::thread ([this] () {run();});
+    dispatchThread = serviceThread.get_id();
+}
+
+void TimerService::run()
+{
+    std::unique_lock <std::mutex> lock (serviceMutex);
+
+    while (! shouldExit)
+    {
+        Clock::time_point deadline = runDueTimers (lock);
+
+        if (! shouldExit)
+        {
+            waitUntil (lock, deadline);
+        }
+    }
+}
+
+TimerService::Clock::time_point TimerService::runDueTimers (std::unique_lock <std::mutex> &lock)
+{
+    while (! heap.empty() && ! shouldExit)
+    {
+        const Entry &front = heap.front();
+
+        // Short period timers may only be called a fraction of their period early.
+        Clock::time_point start = Clock::now();
+        auto window = std::min (coalescingWindow, front.timer->callbackPeriod / 4);
+
+        if (front.deadline > start + window)
+        {
+            return front.deadline;
+        }
+
+        Entry entry = popEntry();
+        Timer *timer = entry.timer;
+
+        recordCallback (*timer, entry.deadline, start);
+
+        timerInCallback = timer;
+        callbackTimerChanged = false;
+        lock.unlock();
+
+        timer->timerCallback();
+
+        lock.lock();
+        timerInCallback = nullptr;
+        callbackFinished.notify_all();
+
+        // The callback may have stopped, restarted or even destroyed its own timer, so
+        // it must not be looked at again unless it is still running as it was.
+        if (callbackTimerChanged)
+        {
+            continue;
+        }
+
+        // Deadlines stay on the original grid. If the callback overran whole periods the
+        // missed ticks are skipped rather than called back to back.
+        Clock::time_point nextDeadline = entry.deadline + timer->callbackPeriod;
+        Clock::time_point now = Clock::now();
+
+        if (nextDeadline <= now)
+        {
+            auto missedTicks = (now - nextDeadline) / timer->callbackPeriod + 1;
+            timer->statistics.missedTicks += static_cast <long> (missedTicks);
+            nextDeadline += missedTicks * timer->callbackPeriod;
+        }
+
+        pushEntry (Entry {nextDeadline, timer});
+    }
+
+    return Clock::time_point::max();
+}
+
+void TimerService::attach (const std::function <void()> &wakeFunction)
+{
+    std::unique_lock <std::mutex> lock (serviceMutex);
+
+    if (serviceThread.joinable())
+    {
+        shouldExit = true;
+        wake();
+        lock.unlock();
+
+        serviceThread.join();
+
+        lock.lock();
+        shouldExit = false;
+    }
+
+    externalWake = wakeFunction;
+    dispatchThread = std::this_thread::get_id();
+}
+
+void TimerService::detach()
+{
+    std::unique_lock <std::mutex> lock (serviceMutex);
+    externalWake = nullptr;
+    lock.unlock();
+
+    startServiceThread();
+}
+
+TimerService::Clock::time_point TimerService::processDueTimers()
+{
+    std::unique_lock <std::mutex> lock (serviceMutex);
+    return runDueTimers (lock);
+}
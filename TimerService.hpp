@@ -0,0 +1,110 @@
+#ifndef TIMER_SERVICE_HPP_INCLUDED
+#define TIMER_SERVICE_HPP_INCLUDED
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Timer.hpp"
+
+/** A singleton class which runs the callbacks of every Timer from one thread.
+ *
+ *  Running timers are kept in a min-heap ordered by their next deadline. The service
+ *  thread sleeps until the earliest deadline and then calls every timer which is due,
+ *  including any due within the coalescing window, so timers with similar deadlines share
+ *  a single wakeup. Stopping or pausing a timer removes its entry from the heap, so the
+ *  heap never refers to a timer which may have been destroyed.
+ *
+ *  While any timer has a period under a millisecond the service thread sleeps on a timerfd
+ *  armed with the absolute deadline, where that is available, rather than on a condition
+ *  variable.
+ *
+ *  While an EventLoop is running, the service thread is stopped and the loop runs the due
+ *  timers on its own thread instead, so timer callbacks never race with input handling.
+ */
+class TimerService
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /** Destructor */
+    ~TimerService();
+
+    /** Get the singleton instance of the timer service. */
+    static TimerService& getInstance();
+
+    /** Set how far ahead of its deadline a timer may be called to share a wakeup with
+     *  an earlier timer.
+     *
+     *  @param newCoalescingWindow the new coalescing window
+     */
+    void setCoalescingWindow (const std::chrono::nanoseconds &newCoalescingWindow);
+
+    /** Returns the number of timers which are running. */
+    std::size_t getNumRunningTimers() const;
+
+private:
+    TimerService();
+    TimerService (const TimerService&) = delete;
+    TimerService& operator= (const TimerService&) = delete;
+
+    /** Timers with periods shorter than this make the service use precise waits. */
+    static constexpr std::chrono::microseconds preciseWaitThreshold {1000};
+
+    struct Entry
+    {
+        Clock::time_point deadline;
+        Timer *timer;
+    };
+
+    mutable std::mutex serviceMutex;
+    std::condition_variable scheduleChanged;
+    std::condition_variable callbackFinished;
+
+    std::vector <Entry> heap;
+    std::size_t numRunningTimers;
+    std::size_t numPreciseTimers;
+    std::chrono::nanoseconds coalescingWindow;
+
+    int timerFd, wakeFd;
+
+    Timer *timerInCallback;
+    /** Set when the timer in its callback is stopped or restarted, so it is not rescheduled. */
+    bool callbackTimerChanged;
+    std::thread serviceThread;
+    std::thread::id dispatchThread;
+    bool shouldExit;
+
+    std::function <void()> externalWake;
+
+    void startTimer (Timer &timer, const std::chrono::nanoseconds &requestedPeriod);
+    void stopTimer (Timer &timer, Timer::ControlState newState);
+    Timer::Statistics getStatistics (const Timer &timer) const;
+    void resetStatistics (Timer &timer);
+
+    void setRunning (Timer &timer, bool running);
+    void wake();
+    void waitUntil (std::unique_lock <std::mutex> &lock, Clock::time_point deadline);
+    void recordCallback (Timer &timer, Clock::time_point deadline, Clock::time_point start);
+
+    void pushEntry (const Entry &entry);
+    Entry popEntry();
+    void removeEntries (const Timer &timer);
+
+    void startServiceThread();
+    void run();
+    Clock::time_point runDueTimers (std::unique_lock <std::mutex> &lock);
+
+    void attach (const std::function <void()> &wakeFunction);
+    void detach();
+    Clock::time_point processDueTimers();
+
+    friend class Timer;
+    friend class EventLoop;
+};
+
+#endif // TIMER_SERVICE_HPP_INCLUDED
@@ -1,4 +1,18 @@
 #include "Slider.hpp"
+#include <algorithm>
+#include "EventLoop.hpp"
+#include "Layout.hpp"
+
+/** A component which draws nothing itself and just holds other components. */
+class SliderBank : public Component
+{
+public:
+    void keyPressed (int) override {}
+
+private:
+    void draw (Window::DrawSession &) override {}
+    void resized() override {}
+};
 
 int main()
 {
@@ -44,43 +58,68 @@ int main()
 
     int sliderWidth = 5;
     int sliderHeights [numSliders] = {30, 26, 35, 19};
-    int sliderY = 0;
-    int sliderX = 2;
+    int bankHeight = *std::max_element (sliderHeights, sliderHeights + numSliders);
 
     double sliderBottoms [numSliders] = {-4.0, 50.0, 37.6, 112.0};
     double sliderTops [numSliders] = {5.0, -12.0, 34.2, 2000.34};
     double sliderSkews [numSliders] = {1.0, 0.9, 12, 0.1};
 
+    SliderBank sliderBank;
+    Layout sliderLayout (Layout::Direction::row);
+
     for (int s = 0; s < numSliders; ++s)
     {
-        sliders [s].setBounds (sliderX, sliderY, sliderWidth, sliderHeights [s]);
+        sliders [s].setLightweight (true);
+        sliderBank.addChildComponent (sliders [s]);
+        sliderLayout.addFixed (sliders [s], sliderWidth);
+        sliderLayout.setCrossSize (sliders [s], sliderHeights [s]);
         sliders [s].setRange (sliderBottoms [s], sliderTops [s], sliderSkews [s]);
-        sliderX += sliderWidth;
     }
 
-    int key;
-    int sliderIndex = 0;
+    sliderBank.setLayout (&sliderLayout);
 
-    while ((key = getch()) != '\n')
-    {
-        switch (key)
-        {
-            case KEY_RIGHT:
-                sliderIndex++;
-                sliderIndex %= numSliders;
-                break;
-
-            case KEY_LEFT:
-                sliderIndex--;
-                sliderIndex = (sliderIndex + numSliders) % numSliders;
-                break;
-
-            default:
-                sliders [sliderIndex].keyPressed (key);
-                break;
-        }
-    }
+    // The sliders are cut down to fit the screen, so only those taller than it change size.
+    auto layOutSliders = [&] (int screenHeight)
+                         {
+                             sliderBank.setBounds (2, 0, sliderWidth * numSliders,
+                                                   std::min (bankHeight, screenHeight));
+                         };
+
+    layOutSliders (curses.getScreenHeight());
+
+    EventLoop eventLoop;
+    int sliderIndex = 0;
 
+    eventLoop.setKeyHandler ([&] (int key, int repeatCount)
+                             {
+                                 switch (key)
+                                 {
+                                     case '\n':
+                                         eventLoop.quit();
+                                         break;
+
+                                     case KEY_RIGHT:
+                                         sliderIndex += repeatCount;
+                                         sliderIndex %= numSliders;
+                                         break;
+
+                                     case KEY_LEFT:
+                                         sliderIndex -= repeatCount % numSliders;
+                                         sliderIndex = (sliderIndex + numSliders) % numSliders;
+                                         break;
+
+                                     default:
+                                         sliders [sliderIndex].keyPressed (key, repeatCount);
+                                         break;
+                                 }
+                             });
+
+    eventLoop.setResizeHandler ([&] (int, int screenHeight)
+                                {
+                                    layOutSliders (screenHeight);
+                                });
+
+    eventLoop.run();
 
     return 0;
 }